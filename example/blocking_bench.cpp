@@ -0,0 +1,79 @@
+// Measures the lag of a 1ms tick on an I/O thread while the requests it serves
+// make a synchronous call, run either inline or with sco::blocking.
+// blocking_bench [milliseconds]
+
+#include <sco/sco.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr auto Tick = std::chrono::milliseconds(1);
+constexpr auto RequestInterval = std::chrono::milliseconds(4);
+constexpr auto BlockingCall = std::chrono::milliseconds(3);
+
+// e.g. a file read or getaddrinfo.
+int blocking_call() {
+    std::this_thread::sleep_for(BlockingCall);
+    return 1;
+}
+
+sco::async<> handle(bool offload, std::size_t* served) {
+    int v = offload ? co_await sco::blocking(&blocking_call) : blocking_call();
+    *served += v;
+}
+
+void run(const char* name, bool offload, std::chrono::milliseconds duration) {
+    sco::loop_executor io;
+    sco::latency_histogram lag;
+    std::size_t started = 0;
+    std::size_t served = 0;
+
+    auto begin = clock_type::now();
+    auto next_tick = begin + Tick;
+    auto next_request = begin;
+    for (;;) {
+        io.poll();
+
+        auto now = clock_type::now();
+        if (now >= next_tick) {
+            lag.record(now - next_tick);
+            next_tick += Tick;
+            if (next_tick <= now) {
+                next_tick = now + Tick;
+            }
+        }
+        if (now - begin >= duration) {
+            if (served == started) {
+                break;
+            }
+        } else if (now >= next_request) {
+            ++started;
+            handle(offload, &served).start_root_in_this_thread(io);
+            next_request += RequestInterval;
+        }
+        std::this_thread::yield();
+    }
+
+    auto us = [](std::chrono::nanoseconds d) {
+        return static_cast<double>(d.count()) / 1000;
+    };
+    std::printf("%8s %10zu %12.1f %12.1f %12.1f\n", name, served,
+        us(lag.quantile(0.5)), us(lag.quantile(0.99)), us(lag.max()));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::chrono::milliseconds duration(argc > 1 ? std::stoi(argv[1]) : 2000);
+
+    std::printf("%8s %10s %12s %12s %12s\n", "mode", "requests", "p50 lag us", "p99 lag us", "max lag us");
+    run("inline", false, duration);
+    run("blocking", true, duration);
+    return 0;
+}
@@ -2,8 +2,12 @@
 
 #include <sco/sco.hpp>
 
+#include <atomic>
 #include <iostream>
+#include <optional>
+#include <ranges>
 #include <future>
+#include <stdexcept>
 #include <vector>
 
 using namespace std::chrono_literals;
@@ -42,19 +46,48 @@ void delay_async(const std::chrono::milliseconds& ms, const std::function<void()
     std::cout << "delay_async return" << std::endl;
 }
 
+// An async function that reports success and failure through different callbacks.
+void div_async(int a, int b, const std::function<void(int)>& ok, const std::function<void(const char*)>& fail) {
+    auto h = std::async(std::launch::async, [=]{
+        std::this_thread::sleep_for(100ms);
+        if (b == 0) {
+            fail("divided by zero");
+        } else {
+            ok(a / b);
+        }
+    });
+    pending_futures.push_back(std::move(h));
+}
+
+// An async function that calls on_data repeatedly, then on_done.
+void count_async(int n, const std::function<void(int)>& on_data, const std::function<void()>& on_done) {
+    auto h = std::async(std::launch::async, [=]{
+        for (int i = 0; i < n; ++i) {
+            std::this_thread::sleep_for(10ms);
+            on_data(i);
+        }
+        on_done();
+    });
+    pending_futures.push_back(std::move(h));
+}
+
+const sco::latency_site plus_site("plus_async");
+
 sco::async<int> plus(int a, int b) {
     int c{};
-    co_await sco::call_with_callback(&plus_async, a, b, sco::cb_tie<void(int)>(c));
+    // the latency is recorded under a named site.
+    co_await sco::timed(plus_site, sco::call_with_callback(&plus_async, a, b, sco::cb_tie<void(int)>(c)));
     co_return c;
 }
 
 sco::async<int> mul(int a, int b) {
     int c{};
-    co_await sco::call_with_callback(&mul_async, a, b, sco::cb_tie<void(int)>(c));
+    // the latency is recorded under the callsite.
+    co_await sco::timed(sco::call_with_callback(&mul_async, a, b, sco::cb_tie<void(int)>(c)));
     co_return c;
 }
 
-sco::async<> delay(const std::chrono::milliseconds& ms) {
+sco::async<> delay(std::chrono::milliseconds ms) {
     co_await sco::call_with_callback(&delay_async, ms, sco::cb_tie<void()>());
     co_return;
 }
@@ -128,12 +161,341 @@ sco::async<bool> test3(int a, int b) {
     co_return true;
 }
 
+sco::async<> test4(int a, int b) {
+    int c{};
+    try {
+        co_await sco::call_with_callback(&div_async, a, b, sco::cb_tie<void(int)>(c),
+            // the error callback converts its arguments to an exception.
+            sco::cb_error<void(const char*)>([](const char* msg) { return std::runtime_error(msg); }));
+        std::cout << "test4 " << a << " / " << b << " = " << c << std::endl;
+    } catch (const std::exception& e) {
+        std::cout << "test4 " << a << " / " << b << " failed: " << e.what() << std::endl;
+    }
+
+    // construct the result in place and collect the results of several calls.
+    std::optional<int> q;
+    std::vector<int> all;
+    co_await sco::call_with_callback(&plus_async, a, b, sco::cb_tie<void(int)>(sco::wemplace(q)));
+    co_await sco::call_with_callback(&mul_async, a, b, sco::cb_tie<void(int)>(sco::wappend(all)));
+    all.push_back(*q);
+    std::cout << "test4 " << a << " * " << b << " = " << all[0] << ", " << a << " + " << b << " = " << all[1] << std::endl;
+
+    // turn the repeated callback into a stream.
+    sco::stream<int> s(4);
+    count_async(10, s.on_data<void(int)>(), s.on_done<void()>());
+    int sum{};
+    while (auto v = co_await s.next()) {
+        sum += *v;
+    }
+    std::cout << "test4 stream sum = " << sum << std::endl;
+
+    std::cout << "test4 finish" << std::endl;
+    co_return;
+}
+
+enum class lookup_error { not_found };
+
+// Routine failures are returned as values instead of exceptions.
+sco::async<sco::expected<int, lookup_error>> lookup(int key) {
+    int v = co_await plus(key, key);
+    if (key < 0) {
+        co_return sco::unexpected(lookup_error::not_found);
+    }
+    co_return v;
+}
+
+sco::async<sco::expected<int, lookup_error>> lookup_sum(int a, int b) {
+    // co_await of an error returns it from lookup_sum immediately.
+    int x = co_await co_await lookup(a);
+    int y = co_await co_await lookup(b);
+    co_return x + y;
+}
+
+// A coroutine without exception storage in its frame.
+sco::async<void, sco::nothrow> test6() {
+    auto ok = co_await lookup_sum(1, 2);
+    auto fail = co_await lookup_sum(-1, 2);
+    std::cout << "test6 lookup_sum(1, 2) = " << *ok
+        << ", lookup_sum(-1, 2) has value: " << fail.has_value() << std::endl;
+
+    std::cout << "test6 finish" << std::endl;
+    co_return;
+}
+
+sco::async<int> fail_after(std::chrono::milliseconds ms) {
+    co_await delay(ms);
+    throw std::runtime_error("failed leg");
+}
+
+// Keep the results of the legs that succeeded.
+sco::async<> test7() {
+    auto [a, b, c] = co_await sco::all_settled(plus(1, 2), fail_after(10ms), delay(10ms));
+    std::cout << "test7 " << *a << ", failed: " << !b.has_value() << ", void ok: " << c.has_value() << std::endl;
+
+    std::vector<sco::async<int>> asyncs;
+    asyncs.push_back(fail_after(10ms));
+    asyncs.push_back(mul(3, 4));
+    auto r = co_await sco::all_settled(asyncs.begin(), asyncs.end());
+    std::cout << "test7 failed: " << !r[0].has_value() << ", " << *r[1] << std::endl;
+
+    // fail fast, the slow leg is abandoned.
+    auto begin = std::chrono::steady_clock::now();
+    try {
+        co_await sco::all_or_fail(plus(1, 2), fail_after(10ms));
+    } catch (const std::exception& e) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+        std::cout << "test7 all_or_fail: " << e.what() << " after " << ms.count() << "ms" << std::endl;
+    }
+    auto [x, y] = co_await sco::all_or_fail(plus(1, 2), mul(3, 4));
+    std::cout << "test7 all_or_fail " << x << ", " << y << std::endl;
+
+    std::cout << "test7 finish" << std::endl;
+    co_return;
+}
+
+// Fails until it has been called n times.
+sco::async<int> flaky(int& calls, int n) {
+    co_await delay(10ms);
+    if (++calls < n) {
+        throw std::runtime_error("flaky");
+    }
+    co_return calls;
+}
+
+sco::async<int> slow_plus(std::chrono::milliseconds ms, int a, int b) {
+    co_await delay(ms);
+    co_return co_await plus(a, b);
+}
+
+// Retries with backoff, and a hedged second attempt.
+sco::async<> test11() {
+    int calls = 0;
+    sco::retry_policy policy;
+    policy.max_attempts = 5;
+    policy.sleep = [](std::chrono::milliseconds ms) { return delay(ms); };
+    auto n = co_await sco::retry([&calls] { return flaky(calls, 3); }, policy);
+    std::cout << "test11 retry succeeded after " << n << " attempts" << std::endl;
+
+    // the first attempt is slow, the second one starts after 100ms and wins.
+    int attempt = 0;
+    auto begin = std::chrono::steady_clock::now();
+    auto v = co_await sco::hedge([&attempt] {
+        return slow_plus(attempt++ == 0 ? 3s : 0ms, 1, 2);
+    }, 100ms, policy.sleep);
+    auto s = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - begin);
+    std::cout << "test11 hedge " << v << " after " << s.count() << "s" << std::endl;
+
+    std::cout << "test11 finish" << std::endl;
+    co_return;
+}
+
+sco::async<int> limited_plus(sco::adaptive_limiter& limiter, int a, int b) {
+    auto permit = co_await limiter.acquire();
+    co_return co_await plus(a, b);
+}
+
+// At most 2 calls in flight at first, the limit follows the round-trip time.
+sco::async<> test12() {
+    sco::adaptive_limiter::options opts;
+    opts.initial_limit = 2;
+    sco::adaptive_limiter limiter(opts);
+
+    std::vector<sco::async<int>> calls;
+    for (int i = 0; i < 6; ++i) {
+        calls.push_back(limited_plus(limiter, i, i));
+    }
+    auto begin = std::chrono::steady_clock::now();
+    auto r = co_await sco::all(calls.begin(), calls.end());
+    auto s = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - begin);
+    std::cout << "test12 " << r.size() << " calls in " << s.count() << "s, limit " << limiter.limit() << std::endl;
+
+    std::cout << "test12 finish" << std::endl;
+    co_return;
+}
+
+// Shape the calls to 20 per second with bursts of 2.
+sco::async<> test13() {
+    sco::rate_limiter qps(20, 2, [](std::chrono::nanoseconds d, std::function<void()> fn) {
+        std::thread([d, fn = std::move(fn)] {
+            std::this_thread::sleep_for(d);
+            fn();
+        }).detach();
+    });
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < 6; ++i) {
+        co_await qps.acquire();
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+    std::cout << "test13 6 tokens in about " << (ms.count() + 50) / 100 * 100 << "ms" << std::endl;
+
+    std::cout << "test13 finish" << std::endl;
+    co_return;
+}
+
+struct fake_conn {
+    int id;
+};
+
+// Two connections shared by four calls.
+sco::async<> test14() {
+    std::atomic_int created = 0;
+    // the factory is kept by the pool, so its captures outlive the frames.
+    sco::pool<fake_conn> conns([&created]() -> sco::async<fake_conn> {
+        co_await delay(10ms);
+        co_return fake_conn{++created};
+    }, {.max_size = 2});
+
+    auto call = [](sco::pool<fake_conn>& p, int a) -> sco::async<int> {
+        auto conn = co_await p.acquire();
+        co_return co_await plus(conn->id, a);
+    // can not use capture list in lambda coroutines within the thread context.
+    };
+    auto r = co_await sco::all(call(conns, 10), call(conns, 20), call(conns, 30), call(conns, 40));
+    std::cout << "test14 " << std::get<0>(r) + std::get<1>(r) + std::get<2>(r) + std::get<3>(r)
+        << " with " << created.load() << " connections" << std::endl;
+
+    std::cout << "test14 finish" << std::endl;
+    co_return;
+}
+
+// CPU-bound work runs on a thread pool without blocking the awaiting thread.
+sco::async<> test8(sco::thread_pool& pool) {
+    std::vector<int> v(1000);
+    co_await sco::parallel_for(pool, std::views::iota(0, 1000), 100, [&](int i) {
+        v[i] = i * i;
+    });
+
+    auto sum = co_await sco::parallel_reduce(pool, v, 100, 0L,
+        [](long acc, int x) { return acc + x; },
+        [](long a, long b) { return a + b; });
+    std::cout << "test8 sum of squares = " << sum << std::endl;
+
+    std::cout << "test8 finish" << std::endl;
+    co_return;
+}
+
+// The callbacks fire in other threads, but the coroutine is always resumed by the home executor.
+sco::async<> test5(sco::loop_executor& home, std::thread::id home_id) {
+    auto r = co_await sco::all(plus(1, 2), mul(3, 4));
+    std::cout << "test5 " << std::get<0>(r) + std::get<1>(r)
+        << " resumed in home thread: " << (std::this_thread::get_id() == home_id) << std::endl;
+
+    std::cout << "test5 finish" << std::endl;
+    home.stop();
+    co_return;
+}
+
+// The user request and the background refresh share one thread,
+// the completions of the user request are queued at the higher priority.
+sco::async<> test9(const char* name, sco::priority_executor& io, int& running) {
+    auto d = co_await plus(1, 2);
+    d = co_await mul(d, d);
+    std::cout << "test9 " << name << " " << d << std::endl;
+
+    if (--running == 0) {
+        std::cout << "test9 finish" << std::endl;
+        io.stop();
+    }
+    co_return;
+}
+
+// The continuations stay on the workers of one NUMA node.
+sco::async<> test10(sco::numa_pool::node_executor& node, std::promise<void>& done) {
+    std::vector<int> v(1000, 1);
+    auto sum = co_await sco::parallel_reduce(node, v, 100, 0,
+        [](int acc, int x) { return acc + x; },
+        [](int a, int b) { return a + b; });
+    std::cout << "test10 node " << node.topology().id << " sum = " << sum << std::endl;
+
+    std::cout << "test10 finish" << std::endl;
+    done.set_value();
+    co_return;
+}
+
+// A synchronous call run in the blocking pool, the calling thread is not blocked.
+sco::async<> test15() {
+    auto n = co_await sco::blocking([] {
+        std::this_thread::sleep_for(100ms);
+        return 15;
+    });
+    std::cout << "test15 blocking returned " << n << std::endl;
+
+    try {
+        co_await sco::blocking([] { throw std::runtime_error("blocking failed"); });
+    } catch (const std::exception& e) {
+        std::cout << "test15 " << e.what() << std::endl;
+    }
+
+    std::cout << "test15 finish" << std::endl;
+    co_return;
+}
+
+struct request_info {
+    std::string trace_id;
+};
+
+// Reads the context of the request that awaits it, several levels up.
+sco::async<std::string> traced(std::string what) {
+    auto* info = co_await sco::this_context<request_info>();
+    co_return what + " [" + (info ? info->trace_id : "untraced") + "]";
+}
+
+sco::async<std::string> traced_plus(int a, int b) {
+    auto r = co_await plus(a, b);
+    co_return co_await traced("plus " + std::to_string(r));
+}
+
+// The context lives in the frame of the root, an inner block binds its own until the block ends.
+sco::async<> test16() {
+    sco::context<request_info> ctx{"trace-16"};
+    auto bound = co_await sco::bind_context(ctx);
+
+    std::cout << "test16 " << co_await traced_plus(8, 8) << std::endl;
+    {
+        sco::context<request_info> inner{"trace-16-inner"};
+        auto inner_bound = co_await sco::bind_context(inner);
+        std::cout << "test16 " << co_await traced("inner") << std::endl;
+    }
+    std::cout << "test16 " << co_await traced("outer") << std::endl;
+
+    std::cout << "test16 finish" << std::endl;
+    co_return;
+}
+
+sco::async<int> ready(int v) {
+    co_return v;
+}
+
+// 1000 synchronous completions, the budget of the thread bounds how many run inline in a row.
+sco::async<> test17(int& sum) {
+    for (int i = 1; i <= 1000; ++i) {
+        sum += co_await ready(i);
+    }
+    std::cout << "test17 finish" << std::endl;
+}
+
+sco::thread_pool& get_pool() {
+    static sco::thread_pool ret(4);
+    return ret;
+}
+
 sco::async<> root() {
     // any async type can be converted to sco::async<>.
     std::vector<sco::async<void>> asyncs;
     asyncs.push_back(test1(1, 2, 3));
     asyncs.emplace_back(test2(4, 5));
     asyncs.emplace_back(test3(6, 7));
+    asyncs.emplace_back(test4(8, 0));
+    asyncs.emplace_back(test6());
+    asyncs.emplace_back(test7());
+    asyncs.emplace_back(test8(get_pool()));
+    asyncs.emplace_back(test11());
+    asyncs.emplace_back(test12());
+    asyncs.emplace_back(test13());
+    asyncs.emplace_back(test14());
+    asyncs.emplace_back(test15());
+    asyncs.emplace_back(test16());
     co_await sco::all(asyncs.begin(), asyncs.end());
 }
 
@@ -144,5 +506,40 @@ int main() {
     std::cout << "main thread end" << std::endl;
 
     std::this_thread::sleep_for(5s);
+
+    // run a root coroutine with a home executor in the main thread.
+    sco::loop_executor home;
+    test5(home, std::this_thread::get_id()).start_root_in_this_thread(home);
+    home.run();
+
+    // run the roots on the lanes of a priority executor.
+    sco::priority_executor io(2);
+    int running = 2;
+    test9("background refresh", io, running).start_root_in_this_thread(io.lane(1));
+    test9("user request", io, running).start_root_in_this_thread(io.lane(0));
+    io.run();
+
+    // one worker pinned to each CPU, grouped by NUMA node.
+    sco::numa_pool numa;
+    std::cout << "numa nodes: " << numa.nodes() << ", workers: " << numa.size() << std::endl;
+    std::promise<void> done;
+    test10(numa.node(0), done).start_root_in_this_thread(numa.node(0));
+    done.get_future().wait();
+
+    // the continuations beyond the resume budget are posted to the loop, between its polls.
+    sco::loop_executor fair;
+    int sum = 0;
+    sco::set_resume_budget({.max_resumes = 256});
+    test17(sum).start_root_in_this_thread(fair);
+    std::size_t slices = 1;
+    while (fair.poll() > 0) {
+        ++slices;
+    }
+    std::cout << "test17 sum = " << sum << " in " << slices << " slices of "
+        << sco::get_resume_budget().max_resumes << " resumes" << std::endl;
+    sco::set_resume_budget({});
+
+    // the latency histograms of all threads.
+    std::cout << sco::latency_prometheus();
     return 0;
 }
@@ -0,0 +1,74 @@
+// Reports the promise layout and the memory held by suspended coroutines.
+// frame_footprint [count]
+
+#include <sco/sco.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+std::vector<std::function<void()>> parked;
+
+// Keeps the callback until all coroutines are suspended.
+void park_async(const std::function<void()>& cb) {
+    parked.push_back(cb);
+}
+
+sco::async<> leaf() {
+    co_await sco::call_with_callback(&park_async, sco::cb_tie<void()>());
+    co_return;
+}
+
+// A two-level chain, like a request handler waiting on one I/O call.
+sco::async<> connection() {
+    co_await leaf();
+    co_return;
+}
+
+long rss_bytes() {
+    long pages = 0;
+    long resident = 0;
+    std::ifstream("/proc/self/statm") >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+template<typename Ret, typename Policy = sco::throwing>
+void print_promise(const char* name) {
+    std::printf("%-40s %4zu\n", name, sizeof(typename sco::async<Ret, Policy>::promise_type));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t n = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+    std::printf("%-40s %4zu\n", "promise_type_base", sizeof(sco::detail::promise_type_base));
+    std::printf("%-40s %4zu\n", "promise_shared (in the awaiter)", sizeof(sco::detail::promise_shared));
+    print_promise<void>("promise of async<>");
+    print_promise<void, sco::nothrow>("promise of async<void, nothrow>");
+    print_promise<int>("promise of async<int>");
+    print_promise<int, sco::nothrow>("promise of async<int, nothrow>");
+    print_promise<std::string>("promise of async<std::string>");
+
+    parked.reserve(n);
+    auto before = rss_bytes();
+    for (std::size_t i = 0; i < n; ++i) {
+        connection().start_root_in_this_thread();
+    }
+    auto after = rss_bytes();
+
+    std::printf("%zu suspended coroutine chains: %.1f MiB, %ld bytes per chain\n",
+        n, static_cast<double>(after - before) / (1024 * 1024), (after - before) / static_cast<long>(n));
+
+    // resume and finish them all.
+    for (auto& cb : parked) {
+        cb();
+    }
+    parked.clear();
+    return 0;
+}
@@ -0,0 +1,407 @@
+// Closed-loop load generator for httpcache.
+// It starts a stub upstream and a RESP fake in this process, runs httpcache
+// as a child process pointing at them, and needs no network access.
+//
+// httpcache_bench [--concurrency N] [--threads N] [--duration SECONDS]
+//                 [--workload hit|miss|mixed|all] [--hit-ratio PERCENT] [--body-size BYTES]
+
+#include <sco/sco.hpp>
+#include <hv/HttpServer.h>
+#include <hv/AsyncHttpClient.h>
+#include <hv/TcpServer.h>
+#include <hv/requests.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+const int CachePort = 18888;
+const int UpstreamPort = 18889;
+const int RedisPort = 18890;
+const int HitKeys = 100;
+const int ClientThreads = 4;
+
+enum class workload { hit, miss, mixed };
+
+struct options {
+    int concurrency = 64;
+    int threads = 4;
+    int duration = 5;
+    int hit_ratio = 90;
+    std::size_t body_size = 16 * 1024;
+    std::vector<workload> workloads{workload::hit, workload::miss, workload::mixed};
+};
+
+const char* to_string(workload w) {
+    switch (w) {
+    case workload::hit: return "hit";
+    case workload::miss: return "miss";
+    case workload::mixed: return "mixed";
+    }
+    return "";
+}
+
+////////////
+// stub upstream, replaces RemoteUrl.
+
+class stub_upstream {
+public:
+    explicit stub_upstream(std::size_t body_size)
+        : page_("<html><body>" + std::string(body_size, 'x') + "</body></html>") {
+        router_.GET("/", [this](HttpRequest*, HttpResponse* resp) {
+            resp->content_type = TEXT_HTML;
+            resp->body = page_;
+            return 200;
+        });
+        server_.registerHttpService(&router_);
+        server_.setPort(UpstreamPort);
+        server_.setThreadNum(2);
+        server_.start();
+    }
+
+private:
+    std::string page_;
+    hv::HttpService router_;
+    hv::HttpServer server_;
+};
+
+////////////
+// RESP fake, understands the GET/SET/MGET commands used by httpcache.
+
+class resp_fake {
+public:
+    resp_fake() {
+        server_.createsocket(RedisPort, "127.0.0.1");
+        server_.onConnection = [](const hv::SocketChannelPtr& ch) {
+            if (ch->isConnected()) {
+                ch->newContext<std::string>();
+            } else {
+                ch->deleteContext<std::string>();
+            }
+        };
+        server_.onMessage = [this](const hv::SocketChannelPtr& ch, hv::Buffer* buf) {
+            auto* in = ch->getContext<std::string>();
+            in->append(static_cast<const char*>(buf->data()), buf->size());
+
+            std::string out;
+            std::size_t pos = 0;
+            std::vector<std::string> args;
+            while (parse_command(*in, pos, args)) {
+                execute(args, out);
+            }
+            in->erase(0, pos);
+            if (!out.empty()) {
+                ch->write(out);
+            }
+        };
+        server_.setThreadNum(1);
+        server_.start();
+    }
+
+private:
+    hv::TcpServer server_;
+    std::mutex mu_;
+    std::unordered_map<std::string, std::string> data_;
+
+    // Returns false if the buffer does not hold a complete command yet.
+    static bool parse_command(const std::string& buf, std::size_t& pos, std::vector<std::string>& args) {
+        auto line = [&](std::size_t& p) -> long {
+            auto e = buf.find("\r\n", p);
+            if (e == std::string::npos) {
+                return -2;
+            }
+            auto n = std::stol(buf.substr(p + 1, e - p - 1));
+            p = e + 2;
+            return n;
+        };
+
+        auto p = pos;
+        if (p >= buf.size() || buf[p] != '*') {
+            return false;
+        }
+        auto n = line(p);
+        if (n < 0) {
+            return false;
+        }
+
+        args.clear();
+        for (long i = 0; i < n; ++i) {
+            if (p >= buf.size()) {
+                return false;
+            }
+            auto len = line(p);
+            if (len < 0 || p + len + 2 > buf.size()) {
+                return false;
+            }
+            args.emplace_back(buf, p, len);
+            p += len + 2;
+        }
+        pos = p;
+        return true;
+    }
+
+    static void bulk(std::string& out, const std::string* v) {
+        if (!v) {
+            out += "$-1\r\n";
+            return;
+        }
+        out += "$" + std::to_string(v->size()) + "\r\n";
+        out += *v;
+        out += "\r\n";
+    }
+
+    // TTLs are ignored, the benchmark never runs long enough to expire keys.
+    void execute(std::vector<std::string>& args, std::string& out) {
+        if (args.empty()) {
+            return;
+        }
+        auto& cmd = args[0];
+        std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+
+        std::lock_guard<std::mutex> lock(mu_);
+        if (cmd == "GET" && args.size() == 2) {
+            auto it = data_.find(args[1]);
+            bulk(out, it != data_.end() ? &it->second : nullptr);
+        } else if (cmd == "MGET") {
+            out += "*" + std::to_string(args.size() - 1) + "\r\n";
+            for (std::size_t i = 1; i < args.size(); ++i) {
+                auto it = data_.find(args[i]);
+                bulk(out, it != data_.end() ? &it->second : nullptr);
+            }
+        } else if (cmd == "SET" && args.size() >= 3) {
+            data_[args[1]] = std::move(args[2]);
+            out += "+OK\r\n";
+        } else if (cmd == "PING") {
+            out += "+PONG\r\n";
+        } else {
+            out += "-ERR unknown command\r\n";
+        }
+    }
+};
+
+////////////
+// httpcache under test, runs as a child process.
+
+class httpcache_process {
+public:
+    explicit httpcache_process(int threads) {
+        pid_ = fork();
+        if (pid_ == 0) {
+            // the server logs every hit, keep it out of the report.
+            auto null = open("/dev/null", O_WRONLY);
+            dup2(null, STDOUT_FILENO);
+
+            auto port = std::to_string(CachePort);
+            auto upstream = "http://127.0.0.1:" + std::to_string(UpstreamPort);
+            auto redis = "tcp://127.0.0.1:" + std::to_string(RedisPort);
+            auto thread_num = std::to_string(threads);
+            execl(HTTPCACHE_PATH, "httpcache", port.c_str(), upstream.c_str(), redis.c_str(),
+                thread_num.c_str(), nullptr);
+            _exit(127);
+        }
+
+        // wait for the listen socket.
+        for (int i = 0; i < 100; ++i) {
+            if (requests::get(url("/ping").c_str())) {
+                return;
+            }
+            std::this_thread::sleep_for(50ms);
+        }
+        throw std::runtime_error("httpcache did not start");
+    }
+
+    ~httpcache_process() {
+        kill(pid_, SIGTERM);
+        waitpid(pid_, nullptr, 0);
+    }
+
+    httpcache_process(const httpcache_process&) = delete;
+    httpcache_process& operator=(const httpcache_process&) = delete;
+
+    static std::string url(const std::string& path) {
+        return "http://127.0.0.1:" + std::to_string(CachePort) + path;
+    }
+
+private:
+    pid_t pid_{};
+};
+
+////////////
+// closed-loop load generator, every user is a root coroutine.
+
+sco::async<HttpResponsePtr> send_async(hv::AsyncHttpClient& client, const HttpRequestPtr& req) {
+    HttpResponsePtr ret;
+    auto cb = sco::cb_tie<void(const HttpResponsePtr&)>(ret);
+    // use lambda to resolve the problem of overload resolution
+    co_await sco::call_with_callback([&](decltype(cb)&& cb) {
+        client.send(req, std::move(cb));
+    }, std::move(cb));
+    co_return ret;
+}
+
+struct user_stats {
+    std::vector<std::uint32_t> latency_us;
+    std::size_t errors{};
+};
+
+// Shared by run() and its users, the last user frame to finish releases it.
+struct run_state {
+    std::vector<user_stats> stats;
+    std::latch done;
+
+    explicit run_state(int users): stats(users), done(users) {}
+};
+
+// Counts the user down when its frame is destroyed, also when an exception escapes it.
+struct count_down_guard {
+    std::latch& done;
+
+    ~count_down_guard() { done.count_down(); }
+};
+
+std::atomic_uint64_t miss_seq{};
+
+std::string pick_path(workload w, int hit_ratio, std::minstd_rand& rnd) {
+    bool hit = w == workload::hit ||
+        (w == workload::mixed && static_cast<int>(rnd() % 100) < hit_ratio);
+    if (hit) {
+        return "/?hit=" + std::to_string(rnd() % HitKeys);
+    }
+    return "/?miss=" + std::to_string(miss_seq++);
+}
+
+sco::async<> user(hv::AsyncHttpClient& client, workload w, int hit_ratio, unsigned seed,
+    std::chrono::steady_clock::time_point deadline, std::shared_ptr<run_state> st, int index)
+{
+    count_down_guard guard{st->done};
+    auto& stats = st->stats[index];
+    std::minstd_rand rnd(seed);
+    while (std::chrono::steady_clock::now() < deadline) {
+        auto req = std::make_shared<HttpRequest>();
+        req->url = httpcache_process::url(pick_path(w, hit_ratio, rnd));
+
+        auto start = std::chrono::steady_clock::now();
+        auto resp = co_await send_async(client, req);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        if (!resp || resp->status_code != HTTP_STATUS_OK) {
+            ++stats.errors;
+            continue;
+        }
+        stats.latency_us.push_back(static_cast<std::uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    }
+    co_return;
+}
+
+void run(workload w, const options& opt, std::vector<std::unique_ptr<hv::AsyncHttpClient>>& clients) {
+    auto st = std::make_shared<run_state>(opt.concurrency);
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(opt.duration);
+    for (int i = 0; i < opt.concurrency; ++i) {
+        user(*clients[i % clients.size()], w, opt.hit_ratio, static_cast<unsigned>(i + 1),
+            deadline, st, i).start_root_in_this_thread();
+    }
+    st->done.wait();
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<std::uint32_t> all;
+    std::size_t errors = 0;
+    for (auto& s : st->stats) {
+        all.insert(all.end(), s.latency_us.begin(), s.latency_us.end());
+        errors += s.errors;
+    }
+    std::sort(all.begin(), all.end());
+
+    auto pct = [&](double q) -> double {
+        if (all.empty()) {
+            return 0;
+        }
+        auto i = std::min(all.size() - 1, static_cast<std::size_t>(q * static_cast<double>(all.size())));
+        return all[i] / 1000.0;
+    };
+
+    std::printf("%-6s %6d %4d %10.0f %9.3f %9.3f %9.3f %8zu\n",
+        to_string(w), opt.concurrency, opt.threads,
+        static_cast<double>(all.size()) / seconds, pct(0.5), pct(0.99), pct(0.999), errors);
+}
+
+options parse_options(int argc, char* argv[]) {
+    options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        std::string val = argv[i + 1];
+        if (key == "--concurrency") {
+            opt.concurrency = std::stoi(val);
+        } else if (key == "--threads") {
+            opt.threads = std::stoi(val);
+        } else if (key == "--duration") {
+            opt.duration = std::stoi(val);
+        } else if (key == "--hit-ratio") {
+            opt.hit_ratio = std::stoi(val);
+        } else if (key == "--body-size") {
+            opt.body_size = std::stoul(val);
+        } else if (key == "--workload") {
+            if (val == "hit") {
+                opt.workloads = {workload::hit};
+            } else if (val == "miss") {
+                opt.workloads = {workload::miss};
+            } else if (val == "mixed") {
+                opt.workloads = {workload::mixed};
+            }
+        } else {
+            throw std::invalid_argument("unknown option " + key);
+        }
+    }
+    return opt;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto opt = parse_options(argc, argv);
+
+    stub_upstream upstream(opt.body_size);
+    resp_fake redis;
+    httpcache_process cache(opt.threads);
+
+    // fill the cache for the hit keys.
+    for (int i = 0; i < HitKeys; ++i) {
+        requests::get(httpcache_process::url("/?hit=" + std::to_string(i)).c_str());
+    }
+    std::this_thread::sleep_for(200ms);
+
+    std::vector<std::unique_ptr<hv::AsyncHttpClient>> clients;
+    for (int i = 0; i < ClientThreads; ++i) {
+        clients.push_back(std::make_unique<hv::AsyncHttpClient>());
+    }
+
+    std::printf("%-6s %6s %4s %10s %9s %9s %9s %8s\n",
+        "load", "conc", "thr", "rps", "p50(ms)", "p99(ms)", "p999(ms)", "errors");
+    for (auto w : opt.workloads) {
+        run(w, opt, clients);
+    }
+    return 0;
+}
@@ -3,6 +3,8 @@
 #include <hv/http_client.h>
 #include <hv/HttpMessage.h>
 #include <hv/requests.h>
+#include <hv/EventLoop.h>
+#include <hv/EventLoopThread.h>
 #include <sw/redis++/async_redis++.h>
 
 #if 0
@@ -12,60 +14,382 @@
 #endif
 
 #include <iostream>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
 
 using namespace sw;
 
 namespace {
 
-const int Port = 8888;
-const char * const RemoteUrl = "https://www.oschina.net";
-const char * const LocalRedis = "tcp://127.0.0.1:6379";
+// can be overridden from the command line:
+// httpcache [port] [remote_url] [redis_url] [thread_num]
+int Port = 8888;
+std::string RemoteUrl = "https://www.oschina.net";
+std::string LocalRedis = "tcp://127.0.0.1:6379";
+int ThreadNum = 4;
 
-// wrap http_client_send_async to sco::async
-sco::async<HttpResponsePtr> client_async(const HttpRequestPtr& req) {
-    HttpResponsePtr ret;
-    co_await sco::call_with_callback(&requests::async, req,
-        sco::cb_tie<void(const HttpResponsePtr&)>(ret));
-    co_return ret;
+// GET commands issued on the same event loop within this window are sent as one MGET.
+const int RedisBatchWindowMs = 1;
+const std::size_t RedisBatchMaxSize = 64;
+
+// The redis connections shared by all the event loops.
+const std::size_t RedisConnections = 8;
+
+// Pages larger than this are still streamed to the client, but not cached.
+const std::size_t MaxCacheBodySize = 1024 * 1024;
+
+// The upstream body queued for a slow client, beyond it the response fails.
+const std::size_t MaxQueuedBodySize = 4 * 1024 * 1024;
+
+// The QPS quota of the upstream.
+const double RemoteQps = 100;
+const std::size_t RemoteBurst = 10;
+
+// redis GET is retried, each attempt has a deadline.
+const int RedisGetAttempts = 3;
+const std::chrono::milliseconds RedisGetTimeout{50};
+
+// The events of an upstream response, produced by the http client thread
+// and consumed by one coroutine with `next`.
+class body_stream {
+public:
+    enum event { head, body, end, error };
+    using callback = std::function<void(event, std::string_view)>;
+
+    // The status and headers are valid after the `head` event.
+    int status_code{};
+    http_headers headers;
+
+    void push_head(const HttpMessage& msg) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            status_code = static_cast<const HttpResponse&>(msg).status_code;
+            headers = msg.headers;
+        }
+        push(head, {});
+    }
+
+    // The consumer may resume after the callback has returned, e.g. when it is posted to an executor,
+    // so the chunk is always copied, into the buffer it reads until its next `next`.
+    void push(event ev, std::string_view data) {
+        std::unique_lock<std::mutex> lock(mu_);
+        if (failed_) {
+            // the rest of a failed response is dropped.
+            return;
+        }
+        if (!waiter_) {
+            if (queued_ + data.size() > MaxQueuedBodySize) {
+                // the consumer is too slow, fail the response instead of buffering all of it.
+                failed_ = true;
+                events_.emplace_back(error, std::string());
+                return;
+            }
+            queued_ += data.size();
+            events_.emplace_back(ev, std::string(data));
+            return;
+        }
+
+        auto cb = std::move(waiter_);
+        waiter_ = nullptr;
+        current_.assign(data);
+        lock.unlock();
+        cb(ev, current_);
+    }
+
+    // async function: fetch the next event.
+    void next(const callback& cb) {
+        std::unique_lock<std::mutex> lock(mu_);
+        if (events_.empty()) {
+            waiter_ = cb;
+            return;
+        }
+
+        auto ev = events_.front().first;
+        queued_ -= events_.front().second.size();
+        current_ = std::move(events_.front().second);
+        events_.pop_front();
+        lock.unlock();
+
+        cb(ev, current_);
+    }
+
+private:
+    std::mutex mu_;
+    // the chunk handed to the consumer, written only while the consumer is in `next`.
+    std::string current_;
+    // only filled while the consumer is busy between two `next`, at most MaxQueuedBodySize bytes.
+    std::deque<std::pair<event, std::string>> events_;
+    std::size_t queued_{};
+    bool failed_{};
+    callback waiter_;
+};
+
+// Send the request to upstream, the response is delivered by the returned stream
+// instead of being buffered into `resp->body`.
+std::shared_ptr<body_stream> client_stream(const HttpRequestPtr& req) {
+    auto stream = std::make_shared<body_stream>();
+    req->http_cb = [stream](HttpMessage* msg, http_parser_state state, const char* data, size_t size) {
+        if (state == HP_HEADERS_COMPLETE) {
+            stream->push_head(*msg);
+        } else if (state == HP_BODY && data && size > 0) {
+            stream->push(body_stream::body, {data, size});
+        }
+    };
+    requests::async(req, [stream](const HttpResponsePtr& resp) {
+        stream->push(resp ? body_stream::end : body_stream::error, {});
+    });
+    return stream;
+}
+
+sco::async<body_stream::event> next_async(body_stream& stream, std::string_view& chunk) {
+    body_stream::event ev{};
+    co_await sco::call_with_callback(&body_stream::next, stream,
+        sco::cb_tie<void(body_stream::event, std::string_view)>(ev, chunk));
+    co_return ev;
+}
+
+bool is_html(const http_headers& headers) {
+    auto it = headers.find("Content-Type");
+    return it != headers.end() && it->second.rfind("text/html", 0) == 0;
 }
 
-auto& get_redis() {
-    static auto ret = redis::AsyncRedis(LocalRedis);
+// One AsyncRedis with a single connection per pooled resource,
+// so the traffic is spread over several connections instead of one.
+using redis_conn = std::unique_ptr<redis::AsyncRedis>;
+
+sco::pool<redis_conn>& get_redis_pool() {
+    // the factory is kept by the pool.
+    static sco::pool<redis_conn> ret([]() -> sco::async<redis_conn> {
+        redis::ConnectionPoolOptions opts;
+        opts.size = 1;
+        co_return std::make_unique<redis::AsyncRedis>(redis::ConnectionOptions(LocalRedis), opts);
+    }, {.max_size = RedisConnections, .shards = static_cast<std::size_t>(ThreadNum)});
     return ret;
 }
 
-sco::async<redis::OptionalString> redis_get_async(const redis::StringView& key) {
-    redis::Future<redis::OptionalString> ret;
-    auto cb = sco::cb_tie<void(redis::Future<redis::OptionalString>&&)>(sco::wmove(ret)); // use move assignment
-    co_await sco::call_with_callback(&redis::AsyncRedis::get<decltype(cb)>, get_redis(), key, std::move(cb));
-    co_return ret.get();
+// Collects the GET commands of many coroutines running on one event loop,
+// sends them as a single MGET and hands every caller its own slice of the reply.
+class redis_get_batcher {
+public:
+    using callback = std::function<void(redis::OptionalString&&, std::exception_ptr)>;
+
+    void get(const redis::StringView& key, const callback& cb) {
+        pending_.push_back({std::string(key.data(), key.size()), cb});
+
+        auto* loop = hv::tlsEventLoop();
+        if (!loop || pending_.size() >= RedisBatchMaxSize) {
+            flush();
+        } else if (!armed_) {
+            // the first command of a batch arms the window timer.
+            armed_ = true;
+            loop->setTimeout(RedisBatchWindowMs, [this](hv::TimerID) {
+                armed_ = false;
+                flush();
+            });
+        }
+    }
+
+private:
+    struct pending {
+        std::string key;
+        callback cb;
+    };
+    std::vector<pending> pending_;
+    bool armed_{};
+
+    void flush() {
+        if (pending_.empty()) {
+            return;
+        }
+
+        auto batch = std::make_shared<std::vector<pending>>(std::move(pending_));
+        pending_.clear();
+        mget(std::move(batch)).start_root_in_this_thread();
+    }
+
+    static sco::async<> mget(std::shared_ptr<std::vector<pending>> batch) {
+        using Reply = std::vector<redis::OptionalString>;
+        Reply vals;
+        std::exception_ptr ex;
+        try {
+            auto conn = co_await get_redis_pool().acquire();
+
+            std::vector<redis::StringView> keys;
+            keys.reserve(batch->size());
+            for (const auto& p : *batch) {
+                keys.emplace_back(p.key);
+            }
+
+            redis::Future<Reply> fut;
+            auto cb = sco::cb_tie<void(redis::Future<Reply>&&)>(sco::wmove(fut));
+            co_await sco::call_with_callback([&](decltype(cb)&& cb) {
+                (*conn)->mget<Reply>(keys.begin(), keys.end(), std::move(cb));
+            }, std::move(cb));
+            vals = fut.get();
+        } catch (...) {
+            ex = std::current_exception();
+        }
+
+        // every waiter is resumed, a handler that throws inline must not strand the rest of the batch.
+        std::exception_ptr thrown;
+        for (std::size_t i = 0; i < batch->size(); ++i) {
+            redis::OptionalString val;
+            if (!ex && i < vals.size()) {
+                val = std::move(vals[i]);
+            }
+            try {
+                (*batch)[i].cb(std::move(val), ex);
+            } catch (...) {
+                if (!thrown) {
+                    thrown = std::current_exception();
+                }
+            }
+        }
+        if (thrown) {
+            std::rethrow_exception(thrown);
+        }
+    }
+};
+
+// one batcher per event loop thread.
+redis_get_batcher& get_batcher() {
+    static thread_local redis_get_batcher ret;
+    return ret;
+}
+
+const sco::latency_site RedisGetSite("redis_get_async");
+
+// The key is kept in the frame, an attempt abandoned on its deadline may still be running.
+sco::async<redis::OptionalString> redis_get_async(std::string key) {
+    redis::OptionalString ret;
+    std::exception_ptr ex;
+    co_await sco::timed(RedisGetSite, sco::call_with_callback(&redis_get_batcher::get, get_batcher(), key,
+        sco::cb_tie<void(redis::OptionalString&&, std::exception_ptr)>(sco::wmove(ret), ex)));
+    if (ex) {
+        std::rethrow_exception(ex);
+    }
+    co_return ret;
 }
 
 sco::async<bool> redis_set_async(const redis::StringView& key, const redis::StringView& value,
     const std::chrono::milliseconds &ttl)
 {
+    auto conn = co_await get_redis_pool().acquire();
+
     redis::Future<bool> ret;
     auto cb = sco::cb_tie<void(redis::Future<bool>&&)>(sco::wmove(ret)); // use move assignment
     // use lambda to resolve the problem of overload resolution
     co_await sco::call_with_callback([&](decltype(cb)&& cb) {
-        get_redis().set(key, value, ttl, std::move(cb));
+        (*conn)->set(key, value, ttl, std::move(cb));
     }, std::move(cb));
     co_return ret.get();
 }
 
+// The context of a request, bound by its handler and read by the coroutines it awaits.
+struct request_info {
+    std::string id;
+};
+
+sco::async<> log_request(std::string what) {
+    auto* info = co_await sco::this_context<request_info>();
+    std::cout << what;
+    if (info && !info->id.empty()) {
+        std::cout << " [" << info->id << "]";
+    }
+    std::cout << std::endl;
+}
+
+// A timer on the given event loop, can be set from any thread:
+// after a redis reply the coroutine runs on the redis++ thread, which has no event loop.
+void sleep_async(hv::EventLoop* loop, std::chrono::milliseconds ms, const std::function<void()>& cb) {
+    loop->runInLoop([loop, ms, cb] {
+        loop->setTimeout(static_cast<int>(std::max<long>(ms.count(), 1)), [cb](hv::TimerID) { cb(); });
+    });
+}
+
+sco::async<> sleep_for(hv::EventLoop* loop, std::chrono::milliseconds ms) {
+    co_await sco::call_with_callback(&sleep_async, loop, ms, sco::cb_tie<void()>());
+}
+
+// Protects the upstream, shared by all the event loops.
+sco::adaptive_limiter& upstream_limiter() {
+    static sco::adaptive_limiter ret;
+    return ret;
+}
+
+// The loop of the rate limiter timer, the limiter is shared by all the event loops
+// and may be entered from a thread without one, e.g. after a redis reply.
+hv::EventLoop* upstream_timer_loop() {
+    static hv::EventLoopThread ret;
+    static const bool started = (ret.start(), true);
+    (void)started;
+    return ret.loop().get();
+}
+
+// Shapes the requests to the QPS quota of the upstream.
+sco::rate_limiter& upstream_rate() {
+    static sco::rate_limiter ret(RemoteQps, RemoteBurst, [](std::chrono::nanoseconds d, std::function<void()> fn) {
+        sleep_async(upstream_timer_loop(), std::chrono::ceil<std::chrono::milliseconds>(d), fn);
+    });
+    return ret;
+}
+
+// The policy of the event loop calling it, the backoff and deadline timers are set on that loop
+// whatever thread the retry runs on. The budget is shared by all the loops.
+const sco::retry_policy& redis_retry_policy() {
+    static sco::retry_budget budget;
+    static thread_local const sco::retry_policy ret = [loop = hv::tlsEventLoop()] {
+        sco::retry_policy p;
+        p.max_attempts = RedisGetAttempts;
+        p.attempt_timeout = RedisGetTimeout;
+        p.budget = &budget;
+        p.sleep = [loop](std::chrono::milliseconds ms) { return sleep_for(loop, ms); };
+        return p;
+    }();
+    return ret;
+}
+
 } // namespace
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        Port = std::stoi(argv[1]);
+    }
+    if (argc > 2) {
+        RemoteUrl = argv[2];
+    }
+    if (argc > 3) {
+        LocalRedis = argv[3];
+    }
+    if (argc > 4) {
+        ThreadNum = std::stoi(argv[4]);
+    }
+
     hv::HttpService router;
 
+    // the latency histograms in the Prometheus text format.
+    router.GET("/metrics", [](HttpRequest* req, HttpResponse* resp) {
+        resp->content_type = TEXT_PLAIN;
+        resp->body = sco::latency_prometheus();
+        return 200;
+    });
+
     router.GET("/", [](const HttpRequestPtr& req, const HttpResponseWriterPtr& writer) {
         // It is better to pass coroutine parameters by value.
         [](HttpRequestPtr req, HttpResponseWriterPtr writer) -> sco::async<> {
+            sco::context<request_info> info{req->GetHeader("X-Request-Id")};
+            auto bound = co_await sco::bind_context(info);
+
             // read from cache first
-            auto val = co_await redis_get_async(req->FullPath());
+            auto val = co_await sco::retry([key = req->FullPath()] { return redis_get_async(key); },
+                redis_retry_policy());
             if (val) {
                 // hit
-                std::cout << "hit: " << req->FullPath() << std::endl;
+                co_await log_request("hit: " + req->FullPath());
 
                 writer->Begin();
                 writer->WriteHeader("Content-Type", "text/html");
@@ -74,38 +398,60 @@ int main() {
                 co_return;
             }
 
-            // miss, request from remote
+            // miss, stream from remote within the concurrency limit of the upstream.
+            co_await log_request("miss: " + req->FullPath());
+            auto permit = co_await upstream_limiter().acquire();
+            co_await upstream_rate().acquire();
             auto req2 = std::make_shared<HttpRequest>();
-            req2->scheme = "https";
             req2->url = RemoteUrl + req->FullPath();
-            auto resp = co_await client_async(req2);
+            auto stream = client_stream(req2);
 
-            // write response content, call it later.
-            auto write_resp = [&]() -> sco::async<> {
+            std::string_view chunk;
+            auto ev = co_await next_async(*stream, chunk);
+            if (ev != body_stream::head) {
                 writer->Begin();
-                if (resp) {
-                    resp->headers.erase("Transfer-Encoding");
-                    writer->WriteResponse(resp.get());
-                } else {
-                    writer->WriteStatus(HTTP_STATUS_NOT_FOUND);
-                    writer->WriteHeader("Content-Type", "text/html");
-                    writer->WriteBody("<center><h1>404 Not Found</h1></center>");
-                }
+                writer->WriteStatus(HTTP_STATUS_NOT_FOUND);
+                writer->WriteHeader("Content-Type", "text/html");
+                writer->WriteBody("<center><h1>404 Not Found</h1></center>");
                 writer->End();
-                // must call co_return explicitly
-                co_return;
-            }; // Do not call the lambda immediately here and return the coroutine,
-            // it should be called at the co_await location instead.
-
-            // write html to cache and write response
-            if (resp && resp->status_code == HTTP_STATUS_OK && resp->ContentType() == TEXT_HTML) {
-                co_await sco::all(
-                    redis_set_async(req->FullPath(), resp->body, std::chrono::seconds(30)),
-                    write_resp());
                 co_return;
             }
 
-            co_await write_resp();
+            // the chunks are forwarded as they arrive,
+            // only the copy for the cache is kept and it is bounded.
+            bool cacheable = stream->status_code == HTTP_STATUS_OK && is_html(stream->headers);
+            std::string cached;
+
+            writer->Begin();
+            writer->WriteStatus(static_cast<http_status>(stream->status_code));
+            bool sized = stream->headers.count("Content-Length") > 0;
+            for (const auto& [k, v] : stream->headers) {
+                if (k != "Transfer-Encoding") {
+                    writer->WriteHeader(k.c_str(), v.c_str());
+                }
+            }
+            if (!sized) {
+                writer->WriteHeader("Transfer-Encoding", "chunked");
+            }
+            writer->EndHeaders();
+
+            while ((ev = co_await next_async(*stream, chunk)) == body_stream::body) {
+                writer->WriteBody(chunk.data(), static_cast<int>(chunk.size()));
+
+                if (cacheable && cached.size() + chunk.size() <= MaxCacheBodySize) {
+                    cached.append(chunk);
+                } else {
+                    cacheable = false;
+                    std::string().swap(cached);
+                }
+            }
+            writer->End();
+            permit.release(ev == body_stream::error);
+
+            // write html to cache
+            if (ev == body_stream::end && cacheable) {
+                co_await redis_set_async(req->FullPath(), cached, std::chrono::seconds(30));
+            }
 
             // must call co_return explicitly
             co_return;
@@ -116,7 +462,7 @@ int main() {
     hv::HttpServer server;
     server.registerHttpService(&router);
     server.setPort(Port);
-    server.setThreadNum(4);
+    server.setThreadNum(ThreadNum);
 
     std::cout << "start http://127.0.0.1:" << Port << std::endl;
     server.run();
@@ -0,0 +1,105 @@
+// Compares starting the roots inside the handlers with starting them in batches,
+// on a simulated event loop where every connection sends one request per iteration.
+// root_batch_bench [iterations]
+
+#include <sco/sco.hpp>
+
+#include "root_batcher.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The socket buffers of the connections, touched by the handlers like a parser would.
+constexpr std::size_t BufferSize = 2048;
+
+struct connection {
+    char in[BufferSize];
+    std::size_t id;
+    std::size_t served;
+};
+
+// The callbacks of the simulated I/O, called in the next loop iteration.
+std::vector<std::function<void(std::size_t)>> completions;
+
+void io_async(std::size_t key, const std::function<void(std::size_t)>& cb) {
+    (void)key;
+    completions.push_back(cb);
+}
+
+sco::async<> handle(connection* conn) {
+    std::size_t v{};
+    co_await sco::call_with_callback(&io_async, conn->id, sco::cb_tie<void(std::size_t)>(v));
+    conn->served += v;
+    co_return;
+}
+
+// The socket handling between two handler calls.
+std::size_t parse(connection& conn) {
+    std::size_t h = 0;
+    for (std::size_t i = 0; i < BufferSize; i += 64) {
+        h = h * 31 + static_cast<unsigned char>(conn.in[i]);
+    }
+    return h;
+}
+
+template<typename Handler>
+double run(std::vector<connection>& conns, int iterations, Handler&& handler, root_batcher* batcher) {
+    std::size_t sink = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        for (auto& conn : conns) {
+            sink += parse(conn);
+            handler(conn);
+        }
+        if (batcher) {
+            batcher->flush();
+        }
+
+        auto done = std::move(completions);
+        completions.clear();
+        for (auto& cb : done) {
+            cb(1);
+        }
+    }
+    auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if (sink == 42) {
+        std::puts("");
+    }
+    return static_cast<double>(conns.size()) * iterations / secs;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 20;
+
+    std::printf("%12s %16s %16s %16s\n", "connections", "inline roots/s", "batched roots/s", "factory roots/s");
+    for (std::size_t n : {1000, 10000, 100000}) {
+        std::vector<connection> conns(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            std::memset(conns[i].in, static_cast<int>(i), BufferSize);
+            conns[i].id = i;
+        }
+
+        auto inline_rate = run(conns, iterations, [](connection& conn) {
+            handle(&conn).start_root_in_this_thread();
+        }, nullptr);
+
+        root_batcher batcher({}, 256);
+        auto batch_rate = run(conns, iterations, [&](connection& conn) {
+            batcher.start(handle(&conn));
+        }, &batcher);
+
+        auto factory_rate = run(conns, iterations, [&](connection& conn) {
+            batcher.start([c = &conn] { return handle(c); });
+        }, &batcher);
+
+        std::printf("%12zu %16.0f %16.0f %16.0f\n", n, inline_rate, batch_rate, factory_rate);
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+// Kept with the benchmark, not exported by sco.hpp until it shows a measured win.
+
+#include <sco/async.hpp>
+#include <sco/executor.hpp>
+
+#include <exception>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Collects the roots created by event loop handlers and starts them in one batch,
+// instead of interleaving their first resume with the socket handling.
+// root_batch_bench shows no throughput gain over starting the roots in the handlers,
+// and a factory costs a std::function, so measure before using it.
+// The batch is started when it reaches max_batch, or by the function given to schedule,
+// which should run it at the end of the current loop iteration.
+// A factory can be passed instead of a root, its frame is allocated when the batch starts,
+// so the frames of a batch are allocated back to back.
+// ```c++
+// thread_local root_batcher batcher([](auto fn) { hv::tlsEventLoop()->queueInLoop(std::move(fn)); });
+// batcher.start([req, writer] { return handle(req, writer); });
+// ```
+class root_batcher {
+public:
+    using scheduler = std::function<void(std::function<void()>)>;
+
+private:
+    scheduler schedule_;
+    std::size_t max_batch_;
+    sco::executor* home_;
+
+    std::vector<sco::async<>> roots_;
+    // the factories not called yet.
+    std::vector<std::function<sco::async<>()>> makers_;
+    std::size_t pending_{};
+    bool armed_{};
+
+public:
+    explicit root_batcher(scheduler schedule = {}, std::size_t max_batch = 64, sco::executor* home = nullptr);
+    ~root_batcher() = default;
+
+    root_batcher(const root_batcher&) = delete;
+    root_batcher& operator=(const root_batcher&) = delete;
+    root_batcher(root_batcher&&) = delete;
+    root_batcher& operator=(root_batcher&&) = delete;
+
+    // Add a root to the next batch.
+    void start(sco::async<>&& root);
+
+    // Add a factory returning the root to the next batch.
+    template<typename F, std::enable_if_t<std::is_invocable_v<std::decay_t<F>&>>* = nullptr>
+    void start(F&& make) {
+        makers_.emplace_back([make = std::decay_t<F>(std::forward<F>(make))]() mutable -> sco::async<> {
+            return make();
+        });
+        added();
+    }
+
+    // Start the pending roots now, returns the number of roots started.
+    // The first exception thrown by a root is rethrown after the others have started.
+    std::size_t flush();
+
+    std::size_t pending() const noexcept { return pending_; }
+
+private:
+    void added();
+};
+
+inline root_batcher::root_batcher(scheduler schedule, std::size_t max_batch, sco::executor* home):
+    schedule_(std::move(schedule)), max_batch_(max_batch == 0 ? 1 : max_batch), home_(home) {
+    roots_.reserve(max_batch_);
+    makers_.reserve(max_batch_);
+}
+
+inline void root_batcher::start(sco::async<>&& root) {
+    roots_.push_back(std::move(root));
+    added();
+}
+
+inline void root_batcher::added() {
+    if (++pending_ >= max_batch_) {
+        flush();
+        return;
+    }
+    if (schedule_ && !armed_) {
+        // the first root of a batch arms the flush.
+        armed_ = true;
+        schedule_([this] {
+            armed_ = false;
+            flush();
+        });
+    }
+}
+
+inline std::size_t root_batcher::flush() {
+    std::exception_ptr ex;
+
+    // allocate the frames of the batch back to back.
+    for (auto& make : makers_) {
+        try {
+            roots_.push_back(make());
+        } catch (...) {
+            if (!ex) {
+                ex = std::current_exception();
+            }
+        }
+    }
+    makers_.clear();
+    pending_ = 0;
+
+    // the roots added while the batch is starting go to the next batch.
+    auto batch = std::move(roots_);
+    roots_.clear();
+    for (auto& root : batch) {
+        try {
+            if (home_) {
+                root.start_root_in_this_thread(*home_);
+            } else {
+                root.start_root_in_this_thread();
+            }
+        } catch (...) {
+            if (!ex) {
+                ex = std::current_exception();
+            }
+        }
+    }
+
+    auto n = batch.size();
+    if (roots_.empty()) {
+        // keep the capacity for the next batch.
+        batch.clear();
+        roots_.swap(batch);
+    }
+
+    if (ex) {
+        std::rethrow_exception(ex);
+    }
+    return n;
+}
@@ -0,0 +1,110 @@
+// Replays a burst of requests against a fake backend with a long latency tail on sco::sim_executor,
+// with and without hedging. The latencies are in virtual time, every run gives the same distribution.
+// sim_bench [requests]
+
+#include <sco/sco.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+sco::sim_executor* sim;
+std::uint64_t rng_state;
+
+// splitmix64, the same sequence on every platform.
+std::uint64_t next_random() {
+    std::uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// 2-6ms, and 50-100ms for one call in 20.
+std::chrono::nanoseconds backend_latency() {
+    auto r = next_random();
+    if (r % 20 == 0) {
+        return 50ms + std::chrono::microseconds(r / 20 % 50000);
+    }
+    return 2ms + std::chrono::microseconds(r / 20 % 4000);
+}
+
+void backend_async(std::uint64_t key, const std::function<void(std::uint64_t)>& cb) {
+    sim->after(backend_latency(), [cb, key] { cb(key); });
+}
+
+sco::async<std::uint64_t> backend_call(std::uint64_t key) {
+    std::uint64_t v{};
+    co_await sco::call_with_callback(&backend_async, key, sco::cb_tie<void(std::uint64_t)>(v));
+    co_return v;
+}
+
+sco::async<> sim_sleep(std::chrono::milliseconds d) {
+    co_await sim->sleep(d);
+}
+
+sco::async<> request(std::uint64_t key, bool hedged, sco::latency_histogram* latency) {
+    auto begin = sim->now();
+    if (hedged) {
+        co_await sco::hedge([key] { return backend_call(key); }, 10ms, [](std::chrono::milliseconds d) {
+            return sim_sleep(d);
+        });
+    } else {
+        co_await backend_call(key);
+    }
+    latency->record(sim->now() - begin);
+}
+
+struct result {
+    sco::latency_histogram latency;
+    double wall_ms{};
+};
+
+result replay(std::size_t requests, bool hedged) {
+    sco::sim_executor executor;
+    sim = &executor;
+    rng_state = 42;
+
+    result ret;
+    auto begin = std::chrono::steady_clock::now();
+    // the requests arrive 10ns apart, all of them are in flight at once.
+    for (std::size_t i = 0; i < requests; ++i) {
+        executor.after(std::chrono::nanoseconds(10 * i), [i, hedged, latency = &ret.latency] {
+            request(i, hedged, latency).start_root_in_this_thread(*sim);
+        });
+    }
+    executor.run();
+    ret.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return ret;
+}
+
+double ms(std::chrono::nanoseconds d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t requests = argc > 1 ? std::stoul(argv[1]) : 100000;
+
+    bool same = true;
+    std::printf("%8s %10s %10s %10s %10s %10s %10s\n", "mode", "requests", "p50 ms", "p99 ms", "p999 ms", "max ms", "wall ms");
+    for (bool hedged : {false, true}) {
+        auto r = replay(requests, hedged);
+        auto& h = r.latency;
+        std::printf("%8s %10llu %10.2f %10.2f %10.2f %10.2f %10.1f\n", hedged ? "hedged" : "plain",
+            static_cast<unsigned long long>(h.count()), ms(h.quantile(0.5)), ms(h.quantile(0.99)),
+            ms(h.quantile(0.999)), ms(h.max()), r.wall_ms);
+
+        // the replay gives the same distribution.
+        auto again = replay(requests, hedged);
+        same = same && again.latency.count() == h.count() && again.latency.sum() == h.sum() &&
+            again.latency.max() == h.max();
+    }
+    std::printf("deterministic: %s\n", same ? "yes" : "no");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+// The libuv awaitables: a timer, a temp file, the thread pool and a loopback tcp echo.
+// uv_example
+
+#include <sco/sco.hpp>
+#include <sco/uv.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+uv_loop_t* loop;
+
+sco::async<> file_test() {
+    char path[] = "/tmp/sco_uv_XXXXXX";
+    auto fd = ::mkstemp(path);
+    if (fd < 0) {
+        throw sco::uv::error(UV_EIO);
+    }
+    ::close(fd);
+
+    auto file = static_cast<uv_file>(co_await sco::uv::fs(loop, uv_fs_open, path, O_WRONLY | O_TRUNC, 0));
+    char data[] = "hello uv";
+    auto buf = uv_buf_init(data, sizeof(data) - 1);
+    auto n = co_await sco::uv::fs(loop, uv_fs_write, file, &buf, 1u, std::int64_t(-1));
+    co_await sco::uv::fs(loop, uv_fs_close, file);
+
+    auto st = co_await sco::uv::fs_stat(loop, path);
+    co_await sco::uv::fs(loop, uv_fs_unlink, path);
+    std::printf("file wrote %zd, size %llu\n", n, static_cast<unsigned long long>(st.st_size));
+
+    try {
+        co_await sco::uv::fs_stat(loop, path);
+    } catch (const sco::uv::error& e) {
+        std::printf("file removed: %s\n", e.what());
+    }
+}
+
+// accept one connection and echo it until the peer closes.
+sco::async<> echo(uv_tcp_t* server) {
+    static uv_tcp_t conn;
+    uv_tcp_init(loop, &conn);
+    if (uv_accept(reinterpret_cast<uv_stream_t*>(server), reinterpret_cast<uv_stream_t*>(&conn)) < 0) {
+        co_return;
+    }
+
+    auto* s = reinterpret_cast<uv_stream_t*>(&conn);
+    char buf[64];
+    while (auto n = co_await sco::uv::read(s, buf, sizeof(buf))) {
+        co_await sco::uv::write(s, std::string_view(buf, n));
+    }
+    uv_close(reinterpret_cast<uv_handle_t*>(&conn), nullptr);
+}
+
+sco::async<> tcp_test() {
+    static uv_tcp_t server, client;
+    uv_tcp_init(loop, &server);
+
+    sockaddr_in addr{};
+    uv_ip4_addr("127.0.0.1", 0, &addr);
+    uv_tcp_bind(&server, reinterpret_cast<const sockaddr*>(&addr), 0);
+    int len = sizeof(addr);
+    uv_tcp_getsockname(&server, reinterpret_cast<sockaddr*>(&addr), &len);
+    uv_listen(reinterpret_cast<uv_stream_t*>(&server), 1, [](uv_stream_t* s, int status) {
+        if (status == 0) {
+            echo(reinterpret_cast<uv_tcp_t*>(s)).start_root_in_this_thread();
+        }
+    });
+
+    uv_tcp_init(loop, &client);
+    co_await sco::uv::connect(&client, reinterpret_cast<const sockaddr*>(&addr));
+
+    auto* s = reinterpret_cast<uv_stream_t*>(&client);
+    co_await sco::uv::write(s, "ping");
+    char buf[64];
+    auto n = co_await sco::uv::read(s, buf, sizeof(buf));
+    std::printf("tcp echo %s\n", std::string(buf, n).c_str());
+
+    uv_close(reinterpret_cast<uv_handle_t*>(&client), nullptr);
+    uv_close(reinterpret_cast<uv_handle_t*>(&server), nullptr);
+}
+
+sco::async<> run() {
+    auto begin = uv_now(loop);
+    co_await sco::uv::sleep(loop, 50);
+    std::printf("slept %llums\n", static_cast<unsigned long long>(uv_now(loop) - begin));
+
+    auto sum = co_await sco::uv::work(loop, [] {
+        int ret = 0;
+        for (int i = 1; i <= 100; ++i) {
+            ret += i;
+        }
+        return ret;
+    });
+    std::printf("work %d\n", sum);
+
+    co_await file_test();
+    co_await tcp_test();
+}
+
+} // namespace
+
+int main() {
+    loop = uv_default_loop();
+
+    run().start_root_in_this_thread();
+    uv_run(loop, UV_RUN_DEFAULT);
+    uv_loop_close(loop);
+    return 0;
+}
@@ -1,6 +1,12 @@
 #pragma once
 
 #include <sco/async.hpp>
+#include <sco/callback.hpp>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
 
 namespace sco {
 
@@ -10,62 +16,105 @@ constexpr decltype(auto) all(Future&& fut) {
     return std::forward<Future>(fut);
 }
 
-// A special case of iterable container of Future.
-template<typename Iter, std::enable_if_t<std::is_base_of_v<
-    std::input_iterator_tag,
-    typename std::iterator_traits<Iter>::iterator_category
->>* = nullptr>
-auto all(Iter begin, Iter end) {
-    using Ret = typename detail::future_traits<typename std::iterator_traits<Iter>::value_type>::return_type;
+namespace detail {
 
-    class future: protected detail::future_base {
-    private:
-        Iter begin_, end_;
+// The outcome of one Future, value or exception.
+template<typename Future>
+auto future_settle(Future& fut) {
+    using Ret = typename future_traits<Future>::return_type;
+    using Settled = expected<Ret, std::exception_ptr>;
 
-    private:
-        int pending_count() {
-            return static_cast<int>(std::distance(begin_, end_));
-        }
+    if (auto ex = future_caller::return_exception(fut)) {
+        return Settled(unexpected(ex));
+    }
+    if constexpr (std::is_void_v<Ret>) {
+        future_caller::return_value(fut);
+        return Settled();
+    } else {
+        return Settled(future_caller::return_value(fut));
+    }
+}
 
-        void set_sync_object(const detail::sync_object& sync) {
-            for (auto it = begin_; it != end_; ++it) {
-                detail::future_caller::set_sync_object(*it, sync);
-            }
+// The Future of an iterable container of Future,
+// if Settled, returns the outcome of each Future instead of the first exception.
+template<typename Iter, bool Settled>
+class all_range_future: protected future_base {
+private:
+    using Ret = typename future_traits<typename std::iterator_traits<Iter>::value_type>::return_type;
+
+    Iter begin_, end_;
+
+private:
+    int pending_count() {
+        return static_cast<int>(std::distance(begin_, end_));
+    }
+
+    void set_sync_object(const sync_object& sync) {
+        for (auto it = begin_; it != end_; ++it) {
+            future_caller::set_sync_object(*it, sync);
         }
+    }
 
-        void resume() {
-            for (auto it = begin_; it != end_; ++it) {
-                detail::future_caller::resume(*it);
-            }
+    void resume() {
+        for (auto it = begin_; it != end_; ++it) {
+            future_caller::resume(*it);
         }
+    }
 
-        std::exception_ptr return_exception() {
+    std::exception_ptr return_exception() {
+        if constexpr (!Settled) {
             for (auto it = begin_; it != end_; ++it) {
-                auto ex = detail::future_caller::return_exception(*it);
+                auto ex = future_caller::return_exception(*it);
                 if (ex) {
                     return ex;
                 }
             }
-            return {};
         }
+        return {};
+    }
 
-        auto return_value() {
-            if constexpr (!std::is_void_v<Ret>) {
-                std::vector<Ret> ret;
-                for (auto it = begin_; it != end_; ++it) {
-                    ret.push_back(detail::future_caller::return_value(*it));
-                }
-                return ret;
+    auto return_value() {
+        if constexpr (Settled) {
+            std::vector<expected<Ret, std::exception_ptr>> ret;
+            for (auto it = begin_; it != end_; ++it) {
+                ret.push_back(future_settle(*it));
+            }
+            return ret;
+        } else if constexpr (!std::is_void_v<Ret>) {
+            std::vector<Ret> ret;
+            for (auto it = begin_; it != end_; ++it) {
+                ret.push_back(future_caller::return_value(*it));
             }
+            return ret;
         }
+    }
 
-        friend detail::future_caller;
+    friend future_caller;
 
-    public:
-        constexpr future(Iter&& begin, Iter&& end):
-            begin_(std::move(begin)), end_(std::move(end)) {}
-    };
-    return future(std::move(begin), std::move(end));
+public:
+    constexpr all_range_future(Iter&& begin, Iter&& end):
+        begin_(std::move(begin)), end_(std::move(end)) {}
+};
+
+template<typename Iter>
+using enable_if_input_iterator_t = std::enable_if_t<std::is_base_of_v<
+    std::input_iterator_tag,
+    typename std::iterator_traits<Iter>::iterator_category
+>>;
+
+} // namespace detail
+
+// A special case of iterable container of Future.
+template<typename Iter, detail::enable_if_input_iterator_t<Iter>* = nullptr>
+auto all(Iter begin, Iter end) {
+    return detail::all_range_future<Iter, false>(std::move(begin), std::move(end));
+}
+
+// Wait for all Futures of the container, returns the value or exception of each one
+// as std::vector<sco::expected<T, std::exception_ptr>>.
+template<typename Iter, detail::enable_if_input_iterator_t<Iter>* = nullptr>
+auto all_settled(Iter begin, Iter end) {
+    return detail::all_range_future<Iter, true>(std::move(begin), std::move(end));
 }
 
 namespace detail {
@@ -116,7 +165,7 @@ auto wrap_awaitable_with_async(T&& t) {
     }
 }
 
-template<typename FT>
+template<typename FT, bool Settled = false>
 class all_future: private future_nocopy {
 private:
     FT ft_;
@@ -139,7 +188,11 @@ private:
     }
 
     auto return_value() {
-        if constexpr (!future_tuple_is_return_void<FT>::value) {
+        if constexpr (Settled) {
+            return std::apply([](auto&&... fut) {
+                return std::make_tuple(future_settle(fut)...);
+            }, ft_);
+        } else if constexpr (!future_tuple_is_return_void<FT>::value) {
             return std::apply([](auto&&... fut) {
                 return std::tuple_cat(future_return_tuple(fut)...);
             }, ft_);
@@ -147,6 +200,9 @@ private:
     }
 
     std::exception_ptr return_exception() {
+        if constexpr (Settled) {
+            return {};
+        }
         exception_first ex;
         std::apply([&](auto&&... fut) {
             (ex.any(fut), ...);
@@ -162,15 +218,228 @@ public:
 
 } // namespace detail
 
+namespace detail {
+
+template<bool Settled, typename... Future>
+auto make_all_future(Future&&... futs) {
+    if constexpr (has_awaitable<Future...>::value) {
+        auto ft = std::tuple_cat(wrap_awaitable_with_async(std::forward<Future>(futs))...);
+        return all_future<decltype(ft), Settled>(std::move(ft));
+    } else {
+        return all_future<std::tuple<Future&&...>, Settled>(
+            std::forward_as_tuple(std::forward<Future>(futs)...));
+    }
+}
+
+} // namespace detail
+
 template<typename... Future>
 auto all(Future&&... futs) {
-    if constexpr (detail::has_awaitable<Future...>::value) {
-        return detail::all_future(
-            std::tuple_cat(detail::wrap_awaitable_with_async(std::forward<Future>(futs))...));
+    return detail::make_all_future<false>(std::forward<Future>(futs)...);
+}
+
+// Wait for all Futures, returns the value or exception of each one
+// as std::tuple<sco::expected<T, std::exception_ptr>...>, void Futures included.
+template<typename... Future>
+auto all_settled(Future&&... futs) {
+    return detail::make_all_future<true>(std::forward<Future>(futs)...);
+}
+
+namespace detail {
+
+template<typename T>
+struct is_async: public std::false_type {};
+
+template<typename Ret, typename Policy>
+struct is_async<async<Ret, Policy>>: public std::true_type {};
+
+template<typename T>
+using async_return_t = typename future_traits<T>::return_type;
+
+// The slot of a leg result, void legs only record that they are done.
+template<typename Ret>
+using fail_fast_slot = std::optional<std::conditional_t<std::is_void_v<Ret>, std::monostate, Ret>>;
+
+// The state shared by the legs of all_or_fail and its Future, kept alive by the legs,
+// so the legs that complete after the awaiter has resumed only touch this state.
+struct fail_fast_state {
+    callback_base cb;
+    std::atomic_int remaining;
+    std::atomic_bool resumed{};
+
+    explicit fail_fast_state(int n): remaining(n) {}
+
+    // A leg is done, the first failure or the last leg resumes the awaiter.
+    void done(const std::exception_ptr& ex) {
+        if (ex) {
+            if (!resumed.exchange(true, std::memory_order_acq_rel)) {
+                *cb.exception = ex;
+                cb.resume();
+            }
+            return;
+        }
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+            !resumed.exchange(true, std::memory_order_acq_rel)) {
+            cb.resume();
+        }
+    }
+
+    executor* home() const {
+        return cb.promise->promise ? cb.promise->promise->executor_ : nullptr;
+    }
+};
+
+template<typename Slots>
+struct fail_fast_values: public fail_fast_state {
+    Slots values;
+
+    fail_fast_values(int n, Slots&& slots): fail_fast_state(n), values(std::move(slots)) {}
+};
+
+// The root coroutine that owns one leg and reports it to the shared state.
+template<typename Leg, typename State, typename Slot>
+async<> fail_fast_leg(Leg leg, std::shared_ptr<State> st, Slot* slot) {
+    try {
+        if constexpr (std::is_void_v<async_return_t<Leg>>) {
+            co_await std::move(leg);
+            slot->emplace();
+        } else {
+            slot->emplace(co_await std::move(leg));
+        }
+    } catch (...) {
+        st->done(std::current_exception());
+        co_return;
+    }
+    st->done({});
+}
+
+template<typename Leg, typename State, typename Slot>
+void start_fail_fast_leg(Leg&& leg, const std::shared_ptr<State>& st, Slot& slot) {
+    auto a = fail_fast_leg(std::move(leg), st, &slot);
+    if (auto* home = st->home()) {
+        a.start_root_in_this_thread(*home);
     } else {
-        return detail::all_future(
-            std::forward_as_tuple(std::forward<Future>(futs)...));
+        a.start_root_in_this_thread();
+    }
+}
+
+// The Future of all_or_fail over a tuple of sco::async.
+template<typename... Leg>
+class all_or_fail_future: protected future_base {
+private:
+    using Slots = std::tuple<fail_fast_slot<async_return_t<Leg>>...>;
+    using State = fail_fast_values<Slots>;
+
+    std::tuple<Leg...> legs_;
+    std::shared_ptr<State> st_;
+
+private:
+    void set_sync_object(const sync_object& sync) {
+        st_->cb.promise = sync;
+        st_->cb.exception = &exception_;
+    }
+
+    void resume() {
+        start(std::index_sequence_for<Leg...>());
+    }
+
+    template<std::size_t... I>
+    void start(std::index_sequence<I...>) {
+        (start_fail_fast_leg(std::move(std::get<I>(legs_)), st_, std::get<I>(st_->values)), ...);
+    }
+
+    template<typename Slot>
+    static auto slot_tuple(Slot& slot) {
+        if constexpr (std::is_same_v<typename Slot::value_type, std::monostate>) {
+            return std::tuple<>{};
+        } else {
+            return std::make_tuple(std::move(*slot));
+        }
+    }
+
+    auto return_value() {
+        if constexpr (!std::conjunction_v<std::is_void<async_return_t<Leg>>...>) {
+            return std::apply([](auto&... slot) {
+                return std::tuple_cat(slot_tuple(slot)...);
+            }, st_->values);
+        }
+    }
+
+    friend future_caller;
+
+public:
+    explicit all_or_fail_future(Leg&&... legs): legs_(std::move(legs)...),
+        st_(std::make_shared<State>(static_cast<int>(sizeof...(Leg)), Slots{})) {}
+};
+
+// The Future of all_or_fail over a range of sco::async.
+template<typename Leg>
+class all_or_fail_range_future: protected future_base {
+private:
+    using Ret = async_return_t<Leg>;
+    using Slots = std::vector<fail_fast_slot<Ret>>;
+    using State = fail_fast_values<Slots>;
+
+    std::vector<Leg> legs_;
+    std::shared_ptr<State> st_;
+
+private:
+    void set_sync_object(const sync_object& sync) {
+        st_->cb.promise = sync;
+        st_->cb.exception = &exception_;
+    }
+
+    void resume() {
+        if (legs_.empty()) {
+            st_->resumed = true;
+            st_->cb.resume();
+            return;
+        }
+        for (std::size_t i = 0; i < legs_.size(); ++i) {
+            start_fail_fast_leg(std::move(legs_[i]), st_, st_->values[i]);
+        }
+    }
+
+    auto return_value() {
+        if constexpr (!std::is_void_v<Ret>) {
+            std::vector<Ret> ret;
+            ret.reserve(st_->values.size());
+            for (auto& slot : st_->values) {
+                ret.push_back(std::move(*slot));
+            }
+            return ret;
+        }
+    }
+
+    friend future_caller;
+
+public:
+    explicit all_or_fail_range_future(std::vector<Leg>&& legs): legs_(std::move(legs)),
+        st_(std::make_shared<State>(static_cast<int>(legs_.size()), Slots(legs_.size()))) {}
+};
+
+} // namespace detail
+
+// Like sco::all, but the first exception is thrown as soon as its leg fails,
+// without waiting for the other legs.
+// The legs are moved into detached roots, those still running are abandoned,
+// they run to completion and their results are dropped.
+template<typename... Ret, typename... Policy>
+auto all_or_fail(async<Ret, Policy>&&... legs) {
+    return detail::all_or_fail_future<async<Ret, Policy>...>(std::move(legs)...);
+}
+
+// all_or_fail over a container of sco::async, the elements are moved out.
+template<typename Iter, detail::enable_if_input_iterator_t<Iter>* = nullptr>
+auto all_or_fail(Iter begin, Iter end) {
+    using Leg = typename std::iterator_traits<Iter>::value_type;
+    static_assert(detail::is_async<Leg>::value, "all_or_fail requires sco::async legs");
+
+    std::vector<Leg> legs;
+    for (; begin != end; ++begin) {
+        legs.push_back(std::move(*begin));
     }
+    return detail::all_or_fail_range_future<Leg>(std::move(legs));
 }
 
 } // namespace sco
@@ -1,6 +1,13 @@
 #pragma once
 
+#include <iterator>
 #include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Define SCO_ASSIGN_NO_COPY to reject at compile time the regular assignments
+// that copy a non-trivially-copyable callback argument,
+// use sco::wmove, sco::wemplace or sco::wappend, or sco::wcopy to copy explicitly.
 
 namespace sco {
 namespace detail {
@@ -9,7 +16,10 @@ namespace detail {
 enum class wrapper_mode {
     move, // T& a = std::move(b)
     unptr, // T& a = *b
-    // ptr, // T* a = &b
+    ptr, // T* a = &b
+    emplace, // a.emplace(std::move(b))
+    append, // a.push_back(std::move(b)) or a.insert(a.end(), b...)
+    copy, // T& a = b
 };
 
 // A wrapper that describes how assignments are made.
@@ -31,23 +41,37 @@ struct is_wrapper: public std::false_type {};
 template<typename T, wrapper_mode m>
 struct is_wrapper<wrapper<T, m>>: public std::true_type {};
 
+template<typename T, wrapper_mode m>
+struct is_mode_wrapper: public std::false_type {};
+
+template<typename T, wrapper_mode m>
+struct is_mode_wrapper<wrapper<T, m>, m>: public std::true_type {};
+
 template<typename T>
-struct is_move_wrapper: public std::false_type {};
+using is_move_wrapper = is_mode_wrapper<T, wrapper_mode::move>;
 
 template<typename T>
-struct is_move_wrapper<wrapper<T, wrapper_mode::move>>: public std::true_type {};
+using is_unptr_wrapper = is_mode_wrapper<T, wrapper_mode::unptr>;
 
 template<typename T>
-struct is_unptr_wrapper: public std::false_type {};
+using is_ptr_wrapper = is_mode_wrapper<T, wrapper_mode::ptr>;
 
 template<typename T>
-struct is_unptr_wrapper<wrapper<T, wrapper_mode::unptr>>: public std::true_type {};
+using is_emplace_wrapper = is_mode_wrapper<T, wrapper_mode::emplace>;
 
-// template<typename T>
-// struct is_ptr_wrapper: public std::false_type {};
+template<typename T>
+using is_append_wrapper = is_mode_wrapper<T, wrapper_mode::append>;
 
-// template<typename T>
-// struct is_ptr_wrapper<wrapper<T, wrapper_mode::ptr>>: public std::true_type {};
+template<typename T>
+using is_copy_wrapper = is_mode_wrapper<T, wrapper_mode::copy>;
+
+template<typename C, typename V, typename=void>
+struct has_push_back: public std::false_type {};
+
+template<typename C, typename V>
+struct has_push_back<C, V, std::void_t<
+    decltype(std::declval<C&>().push_back(std::declval<V>()))
+>>: public std::true_type {};
 
 ////////////
 
@@ -55,7 +79,14 @@ struct is_unptr_wrapper<wrapper<T, wrapper_mode::unptr>>: public std::true_type
 
 template<typename Dst, typename Src,
     std::enable_if_t<!is_wrapper<std::remove_cv_t<Dst>>::value>* = nullptr>
-void assign(Dst& dst, Src&& src) { dst = std::forward<Src>(src); }
+void assign(Dst& dst, Src&& src) {
+#ifdef SCO_ASSIGN_NO_COPY
+    // the callback arguments are always passed as lvalues.
+    static_assert(std::is_trivially_copyable_v<std::remove_cvref_t<Src>>,
+        "copy of a non-trivially-copyable callback argument, use sco::wmove/wemplace/wappend or sco::wcopy");
+#endif
+    dst = std::forward<Src>(src);
+}
 
 template<typename Dst, typename Src,
     std::enable_if_t<is_move_wrapper<Dst>::value>* = nullptr>
@@ -65,9 +96,30 @@ template<typename Dst, typename Src,
     std::enable_if_t<is_unptr_wrapper<Dst>::value>* = nullptr>
 void assign(const Dst& dst, Src&& src) { if (src) { dst.value = *src; } }
 
-// template<typename Dst, typename Src,
-//     std::enable_if_t<is_ptr_wrapper<Dst>::value>* = nullptr>
-// void assign(const Dst& dst, Src&& src) { dst.value = &src; }
+template<typename Dst, typename Src,
+    std::enable_if_t<is_ptr_wrapper<Dst>::value>* = nullptr>
+void assign(const Dst& dst, Src&& src) { dst.value = &src; }
+
+template<typename Dst, typename Src,
+    std::enable_if_t<is_emplace_wrapper<Dst>::value>* = nullptr>
+void assign(const Dst& dst, Src&& src) { dst.value.emplace(std::move(src)); } // NOLINT(bugprone-move-forwarding-reference)
+
+template<typename Dst, typename Src,
+    std::enable_if_t<is_append_wrapper<Dst>::value>* = nullptr>
+void assign(const Dst& dst, Src&& src) {
+    using V = decltype(std::move(src)); // NOLINT(bugprone-move-forwarding-reference)
+    if constexpr (has_push_back<typename Dst::type, V>::value) {
+        dst.value.push_back(std::move(src)); // NOLINT(bugprone-move-forwarding-reference)
+    } else {
+        // append a range of elements.
+        dst.value.insert(dst.value.end(),
+            std::make_move_iterator(std::begin(src)), std::make_move_iterator(std::end(src)));
+    }
+}
+
+template<typename Dst, typename Src,
+    std::enable_if_t<is_copy_wrapper<Dst>::value>* = nullptr>
+void assign(const Dst& dst, Src&& src) { dst.value = src; }
 
 template<typename T0, typename T1, std::size_t... I>
 void assign_mutl(T0& t0, T1& t1, std::index_sequence<I...>) {
@@ -88,7 +140,28 @@ constexpr auto wunptr(T& v) { return detail::wrapper<T, detail::wrapper_mode::un
 
 // Need to use address-of assignment instead of regular assignment.
 // T* a = &b
-// template<typename T>
-// constexpr auto wptr(T& v) { return detail::wrapper<T, detail::wrapper_mode::ptr>(v); }
+// Only for a reference callback parameter, a value parameter dies with the callback.
+// The pointer is only valid when the callback is called asynchronously and resumes the coroutine
+// inline from inside the callback, until the coroutine suspends again, unless the referred object outlives it.
+// It dangles when the callback is called synchronously by the async function
+// or the coroutine has a home executor, the callback has returned when the coroutine resumes.
+template<typename T>
+constexpr auto wptr(T& v) { return detail::wrapper<T, detail::wrapper_mode::ptr>(v); }
+
+// Construct the value in place, e.g. into std::optional<T>,
+// T is never default-constructed in the coroutine.
+// a.emplace(std::move(b))
+template<typename T>
+constexpr auto wemplace(T& v) { return detail::wrapper<T, detail::wrapper_mode::emplace>(v); }
+
+// Append to a container, an element or a range of elements.
+// a.push_back(std::move(b)) or a.insert(a.end(), b...)
+template<typename T>
+constexpr auto wappend(T& v) { return detail::wrapper<T, detail::wrapper_mode::append>(v); }
+
+// Copy explicitly, allowed when SCO_ASSIGN_NO_COPY is defined.
+// T& a = b
+template<typename T>
+constexpr auto wcopy(T& v) { return detail::wrapper<T, detail::wrapper_mode::copy>(v); }
 
 } // namespace sco
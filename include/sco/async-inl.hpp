@@ -8,9 +8,11 @@ namespace sco {
 namespace detail {
 
 SCO_INLINE void start_root_in_this_thread(promise_type_base* promise, const COSTD::coroutine_handle<>& h,
-    const std::function<void()>& clr) {
-    detail::root_result::opt res;
-    promise->set_root_result_from_thread(res);
+    const std::function<void()>& clr, executor* home) {
+    promise->executor_ = home;
+
+    root_result_scope scope;
+    auto& res = scope.res;
     h.resume();
 
     if (!res) {
@@ -36,6 +38,7 @@ SCO_INLINE void start_root_in_this_thread(promise_type_base* promise, const COST
 SCO_INLINE async<void>& async<void>::operator=(async&& other) noexcept {
     h_ = other.h_;
     promise_ = other.promise_;
+    exception_ = other.exception_;
     other.h_ = COSTD::coroutine_handle<>{};
     return *this;
 }
@@ -50,6 +53,10 @@ SCO_INLINE void async<void>::start_root_in_this_thread() {
     detail::start_root_in_this_thread(promise_, h_, [this] { h_ = COSTD::coroutine_handle<>{}; });
 }
 
+SCO_INLINE void async<void>::start_root_in_this_thread(executor& home) {
+    detail::start_root_in_this_thread(promise_, h_, [this] { h_ = COSTD::coroutine_handle<>{}; }, &home);
+}
+
 SCO_INLINE void async<void>::set_sync_object(const detail::sync_object& sync) {
     promise_->set_sync_object_from_future(sync);
 }
@@ -59,7 +66,7 @@ SCO_INLINE void async<void>::resume() {
 }
 
 SCO_INLINE std::exception_ptr async<void>::return_exception() {
-    return promise_->exception_;
+    return exception_(promise_);
 }
 
 } // namespace sco
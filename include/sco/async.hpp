@@ -9,15 +9,15 @@ namespace sco {
 namespace detail {
 
 void start_root_in_this_thread(promise_type_base* promise, const COSTD::coroutine_handle<>& h,
-    const std::function<void()>& clr);
+    const std::function<void()>& clr, executor* home = nullptr);
 
 } // namespace detail
 
-// coroutine type
-template<typename Ret=void>
+// coroutine type, Policy is sco::throwing or sco::nothrow.
+template<typename Ret=void, typename Policy=throwing>
 class async {
 public:
-    using promise_type = detail::promise_type<async, Ret>;
+    using promise_type = detail::promise_type<async, Ret, Policy>;
     using handle_type = typename promise_type::handle_type;
 
 private:
@@ -48,6 +48,11 @@ public:
         detail::start_root_in_this_thread(&h_.promise(), h_, [this] { h_ = handle_type{}; });
     }
 
+    // The coroutines completed in other threads are resumed by the home executor.
+    void start_root_in_this_thread(executor& home) {
+        detail::start_root_in_this_thread(&h_.promise(), h_, [this] { h_ = handle_type{}; }, &home);
+    }
+
 private:
     constexpr int pending_count() const noexcept { return 1; }
     void set_sync_object(const detail::sync_object& sync) {
@@ -55,18 +60,31 @@ private:
     }
     void resume() { h_.resume(); }
     Ret return_value() {
-        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-        return std::move(*h_.promise().value_);
+        if constexpr (!std::is_void_v<Ret>) {
+            return h_.promise().take_value();
+        }
     }
-    std::exception_ptr return_exception() { return h_.promise().exception_; }
+    std::exception_ptr return_exception() { return h_.promise().return_exception(); }
 
     friend detail::future_caller;
     friend async<void>;
 };
 
+namespace detail {
+
+// Get the exception of a type-erased promise.
+using exception_getter = std::exception_ptr (*)(promise_type_base*);
+
+template<typename Promise>
+std::exception_ptr get_exception(promise_type_base* promise) {
+    return static_cast<Promise*>(promise)->return_exception();
+}
+
+} // namespace detail
+
 // specialization for void, and any async type can be converted to async<void>
 template<>
-class async<void> {
+class async<void, throwing> {
 public:
     using promise_type = detail::promise_type<async, void>;
     using handle_type = typename promise_type::handle_type;
@@ -74,23 +92,29 @@ public:
 private:
     COSTD::coroutine_handle<> h_;
     detail::promise_type_base* promise_{};
+    detail::exception_getter exception_{};
 
 public:
-    explicit async(handle_type&& h): h_(h), promise_(&h.promise()) {}
+    explicit async(handle_type&& h): h_(h), promise_(&h.promise()),
+        exception_(&detail::get_exception<promise_type>) {}
 
     // no-copytable
     async(const async&) = delete;
     async& operator=(const async&) = delete;
 
-    template<typename Ret, std::enable_if_t<!std::is_void_v<Ret>>* = nullptr>
-    async(async<Ret>&& other) noexcept { // NOLINT(google-explicit-constructor)
+    template<typename Ret, typename Policy,
+        std::enable_if_t<!std::is_void_v<Ret> || !std::is_same_v<Policy, throwing>>* = nullptr>
+    async(async<Ret, Policy>&& other) noexcept { // NOLINT(google-explicit-constructor)
         operator=(std::move(other));
     }
-    template<typename Ret, std::enable_if_t<!std::is_void_v<Ret>>* = nullptr>
-    async& operator=(async<Ret>&& other) noexcept {
+    template<typename Ret, typename Policy,
+        std::enable_if_t<!std::is_void_v<Ret> || !std::is_same_v<Policy, throwing>>* = nullptr>
+    async& operator=(async<Ret, Policy>&& other) noexcept {
+        using other_promise = typename async<Ret, Policy>::promise_type;
         h_ = other.h_;
         promise_ = &other.h_.promise();
-        other.h_ = typename async<Ret>::handle_type{};
+        exception_ = &detail::get_exception<other_promise>;
+        other.h_ = typename async<Ret, Policy>::handle_type{};
         return *this;
     }
 
@@ -100,6 +124,7 @@ public:
     ~async();
 
     void start_root_in_this_thread();
+    void start_root_in_this_thread(executor& home);
 
 private:
     constexpr int pending_count() const noexcept { return 1; }
@@ -114,9 +139,9 @@ private:
 } // namespace sco
 
 // support 3rd party coroutine framework.
-template<typename Ret>
-inline auto operator co_await(sco::async<Ret>&& a) {
-    return sco::detail::promise_type_base::future_awaiter<sco::async<Ret>>{std::move(a)};
+template<typename Ret, typename Policy>
+inline auto operator co_await(sco::async<Ret, Policy>&& a) {
+    return sco::detail::promise_type_base::future_awaiter<sco::async<Ret, Policy>>{std::move(a)};
 }
 
 #ifdef SCO_HEADER_ONLY
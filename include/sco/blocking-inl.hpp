@@ -0,0 +1,113 @@
+#pragma once
+
+#ifndef SCO_HEADER_ONLY
+# include <sco/blocking.hpp>
+#endif
+
+#include <thread>
+
+namespace sco {
+
+SCO_INLINE blocking_pool::blocking_pool(options opts): opts_(opts) {
+    if (opts_.max_threads == 0) {
+        opts_.max_threads = 1;
+    }
+}
+
+SCO_INLINE blocking_pool::~blocking_pool() {
+    std::unique_lock<std::mutex> lock(mu_);
+    stopped_ = true;
+    cv_.notify_all();
+    exited_.wait(lock, [this] { return threads_ == 0; });
+}
+
+SCO_INLINE void blocking_pool::post(detail::task* t) {
+    t->next_ = nullptr;
+
+    std::lock_guard<std::mutex> lock(mu_);
+    if (tail_) {
+        tail_->next_ = t;
+    } else {
+        head_ = t;
+    }
+    tail_ = t;
+    ++pending_;
+
+    // every idle thread takes one of the pending tasks.
+    if (idle_ >= pending_ || threads_ >= opts_.max_threads) {
+        cv_.notify_one();
+        return;
+    }
+
+    ++threads_;
+    try {
+        std::thread([this] { worker(); }).detach();
+    } catch (...) {
+        --threads_;
+        if (threads_ == 0) {
+            // nobody takes the task, unlink it before the caller sees the error.
+            auto** link = &head_;
+            detail::task* prev{};
+            while (*link != t) {
+                prev = *link;
+                link = &prev->next_;
+            }
+            *link = nullptr;
+            tail_ = prev;
+            --pending_;
+            throw;
+        }
+        // the running threads take the task later.
+    }
+}
+
+SCO_INLINE std::size_t blocking_pool::size() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return threads_;
+}
+
+SCO_INLINE void blocking_pool::worker() {
+    current_scope scope(this);
+
+    std::unique_lock<std::mutex> lock(mu_);
+    for (;;) {
+        while (head_) {
+            auto* t = head_;
+            head_ = t->next_;
+            if (!head_) {
+                tail_ = nullptr;
+            }
+            --pending_;
+
+            lock.unlock();
+            try {
+                t->run_(t);
+            } catch (...) { // NOLINT(bugprone-empty-catch)
+                // the exception of a root coroutine finished here has no caller to go to.
+            }
+            lock.lock();
+        }
+
+        if (stopped_) {
+            break;
+        }
+        ++idle_;
+        bool woken = cv_.wait_for(lock, opts_.idle_timeout, [this] { return head_ || stopped_; });
+        --idle_;
+        if (!woken) {
+            break;
+        }
+    }
+
+    // the pool may be destroyed as soon as the lock is released.
+    if (--threads_ == 0) {
+        exited_.notify_all();
+    }
+}
+
+SCO_INLINE blocking_pool& default_blocking_pool() {
+    static blocking_pool pool;
+    return pool;
+}
+
+} // namespace sco
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <sco/callback.hpp>
+#include <sco/executor.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+
+namespace sco {
+
+// An elastic pool of threads for synchronous calls, e.g. file reads, getaddrinfo or compression,
+// that must not block the I/O threads.
+// A thread is started when a task finds no idle thread, up to max_threads,
+// and exits after waiting idle_timeout for a task.
+class blocking_pool: public executor {
+public:
+    struct options {
+        std::size_t max_threads = 64;
+        std::chrono::milliseconds idle_timeout{std::chrono::seconds(10)};
+    };
+
+private:
+    options opts_;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::condition_variable exited_;
+    detail::task* head_{};
+    detail::task* tail_{};
+    std::size_t pending_{};
+    std::size_t threads_{};
+    std::size_t idle_{};
+    bool stopped_{};
+
+public:
+    blocking_pool(): blocking_pool(options{}) {}
+    explicit blocking_pool(options opts);
+
+    // The pending tasks are run before the threads exit.
+    ~blocking_pool() override;
+
+    void post(detail::task* t) override;
+
+    // The running threads.
+    std::size_t size();
+
+private:
+    void worker();
+};
+
+// The pool used by blocking(fn).
+blocking_pool& default_blocking_pool();
+
+namespace detail {
+
+// The Future running fn in a blocking_pool, the task lives in the awaiting coroutine frame.
+template<typename F>
+class blocking_future: protected future_base,
+    protected future_with_value<std::invoke_result_t<F&>> {
+private:
+    using Ret = std::invoke_result_t<F&>;
+
+    struct call: public task {
+        blocking_future* self;
+    };
+
+    blocking_pool& pool_;
+    F fn_;
+    call task_;
+    callback_base cb_;
+
+private:
+    void set_sync_object(const sync_object& sync) {
+        cb_.promise = sync;
+        cb_.exception = &exception_;
+    }
+
+    void resume() {
+        task_.self = this;
+        task_.run_ = [](task* t) {
+            auto* self = static_cast<call*>(t)->self;
+            try {
+                if constexpr (std::is_void_v<Ret>) {
+                    self->fn_();
+                } else {
+                    self->value_ = self->fn_();
+                }
+            } catch (...) {
+                self->exception_ = std::current_exception();
+            }
+            self->cb_.resume();
+        };
+        pool_.post(&task_);
+    }
+
+    friend future_caller;
+
+public:
+    blocking_future(blocking_pool& pool, F fn): pool_(pool), fn_(std::move(fn)) {}
+};
+
+} // namespace detail
+
+// Run the synchronous fn in the blocking pool, co_await it for the result,
+// the exception thrown by fn is rethrown.
+// The coroutine is resumed by its executor, or in the pool thread if it has none.
+// ```c++
+// auto addrs = co_await sco::blocking([host] { return resolve(host); });
+// ```
+template<typename F>
+auto blocking(blocking_pool& pool, F fn) {
+    return detail::blocking_future<F>(pool, std::move(fn));
+}
+
+template<typename F>
+auto blocking(F fn) {
+    return blocking(default_blocking_pool(), std::move(fn));
+}
+
+} // namespace sco
+
+#ifdef SCO_HEADER_ONLY
+# include <sco/blocking-inl.hpp>
+#endif
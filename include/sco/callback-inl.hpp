@@ -11,19 +11,21 @@ SCO_INLINE void callback_base::resume() {
         return;
     }
 
-    root_result::opt res;
-    promise->promise->set_root_result_from_thread(res);
-
-    promise->handle().resume();
-
-    if (res) {
-        // destroy the root coroutine.
-        res->root_handle().destroy();
+    auto* ex = promise->promise ? promise->promise->executor_ : nullptr;
+    if (ex && ex != executor::current()) {
+        // only publish the completion, the executor resumes the coroutine in its thread.
+        promise->run_ = [](task* t) {
+            resume_in_this_thread(*static_cast<promise_shared*>(t));
+        };
+        ex->post(promise);
+        return;
     }
 
-    if (res && res->exception) {
-        std::rethrow_exception(res->exception);
-    }
-};
+    resume_in_this_thread(*promise);
+}
+
+SCO_INLINE void callback_base::resume_in_this_thread(promise_shared& promise) {
+    resume_sync_in_this_thread(promise);
+}
 
 } // namespace sco::detail
@@ -7,12 +7,30 @@ namespace sco {
 namespace detail {
 
 struct callback_base {
-    promise_shared::ptr promise;
+    promise_shared* promise{};
 
-    // resume the coroutine in the callback thread.
+    // Points to the exception slot of the Future, used by the error callbacks.
+    std::exception_ptr* exception{};
+
+    // resume the coroutine in the callback thread,
+    // or hand it over to the executor of the coroutine.
     void resume();
+
+    // resume the coroutine in the current thread.
+    static void resume_in_this_thread(promise_shared& promise);
 };
 
+// An rvalue of the parameter type is bound as it is, anything else is copied or converted
+// into a temporary that lives until the callback returns, like a by-value parameter.
+template<typename Arg, typename A>
+constexpr decltype(auto) callback_arg(A&& a) {
+    if constexpr (std::is_reference_v<Arg> || std::is_same_v<A, Arg>) {
+        return static_cast<std::add_lvalue_reference_t<Arg>>(a);
+    } else {
+        return Arg(std::forward<A>(a));
+    }
+}
+
 template<typename, typename, typename=void>
 struct callback_tie;
 
@@ -24,7 +42,20 @@ struct callback_tie<void(Args...), Refs,
 
     constexpr explicit callback_tie(Refs&& refs): refs_(std::move(refs)) {}
 
-    void operator()(Args... args) {
+    // The arguments are forwarded, a value parameter given an rvalue is not copied.
+    template<typename... A, std::enable_if_t<sizeof...(A) == sizeof...(Args) &&
+        (std::is_convertible_v<A&&, Args> && ...)>* = nullptr>
+    void operator()(A&&... args) {
+        tie(callback_arg<Args>(std::forward<A>(args))...);
+    }
+
+private:
+    template<typename... P>
+    void tie(P&&... args) {
+        // the address of a value parameter dies with the callback.
+        static_assert(check_ptr(std::make_index_sequence<sizeof...(Args)>()),
+            "sco::wptr requires a reference callback parameter");
+
         // convert the callback arguments to a reference tuple.
         std::tuple<std::add_lvalue_reference_t<Args>...> argsTuple{args...};
 
@@ -33,6 +64,12 @@ struct callback_tie<void(Args...), Refs,
 
         resume();
     }
+
+    template<std::size_t... I>
+    static constexpr bool check_ptr(std::index_sequence<I...>) {
+        return ((!is_ptr_wrapper<std::remove_cvref_t<std::tuple_element_t<I, Refs>>>::value ||
+            std::is_reference_v<Args>) && ...);
+    }
 };
 
 // Specialization for void() callback.
@@ -43,6 +80,33 @@ struct callback_tie<void(), std::tuple<>>: public callback_base {
     void operator()() { resume(); }
 };
 
+template<typename, typename>
+struct callback_error;
+
+// The error callback, stores the exception made by Fn into the Future and resumes.
+template<typename... Args, typename Fn>
+struct callback_error<void(Args...), Fn>: public callback_base {
+    Fn fn_;
+
+    constexpr explicit callback_error(Fn&& fn): fn_(std::move(fn)) {}
+
+    void operator()(Args... args) {
+        using E = std::invoke_result_t<Fn&, std::add_lvalue_reference_t<Args>...>;
+        if constexpr (std::is_same_v<std::decay_t<E>, std::exception_ptr>) {
+            *exception = fn_(args...);
+        } else {
+            *exception = std::make_exception_ptr(fn_(args...));
+        }
+
+        resume();
+    }
+};
+
+// The default error function of a void(std::exception_ptr) callback.
+struct exception_identity {
+    std::exception_ptr operator()(std::exception_ptr& ex) const { return ex; }
+};
+
 // Filtered out callback_base using tuple_cat in combination.
 template<typename T>
 constexpr auto get_callback_base(T&& v) {
@@ -63,30 +127,45 @@ constexpr auto cb_tie(Refs&&... refs) {
     return detail::callback_tie<Sign, std::tuple<Refs...>>(std::tuple<Refs...>{std::forward<Refs>(refs)...});
 }
 
+// create an error callback, the arguments are converted to an exception by fn,
+// which returns either an exception object or a std::exception_ptr.
+template<typename Sign, typename Fn>
+constexpr auto cb_error(Fn&& fn) {
+    return detail::callback_error<Sign, std::decay_t<Fn>>(std::decay_t<Fn>(std::forward<Fn>(fn)));
+}
+
+// create an error callback that receives the std::exception_ptr directly.
+template<typename Sign = void(std::exception_ptr)>
+constexpr auto cb_error() {
+    return detail::callback_error<Sign, detail::exception_identity>(detail::exception_identity{});
+}
+
 // Wrap an asynchronous function into a Future for use with co_await.
+// Several callbacks (e.g. one for success, one for error) may be passed,
+// exactly one of them must be called.
 template<typename F, typename... Args>
 auto call_with_callback(F&& f, Args&&... args) {
     // collect all callback_base
     auto cbs = std::tuple_cat(detail::get_callback_base(std::forward<Args>(args))...);
-    // only support one callback
     static_assert(std::tuple_size_v<decltype(cbs)> > 0, "call_with_callback must be call with a callback");
 
-    auto& cb = std::get<0>(cbs);
     std::tuple<Args&&...> argsTuple{std::forward<Args>(args)...};
 
-    using CB = decltype(cb);
+    using CBS = decltype(cbs);
     using AT = decltype(argsTuple);
 
     class future: protected detail::future_base,
         protected detail::future_with_value<void> {
     private:
-        CB cb_;
+        CBS cbs_;
         AT at_;
         F&& f_;
 
     private:
         void set_sync_object(const detail::sync_object& sync) {
-            cb_.promise = sync;
+            std::apply([&](auto&... cb) {
+                ((cb.promise = sync, cb.exception = &exception_), ...);
+            }, cbs_);
         }
 
         void resume() {
@@ -101,11 +180,11 @@ auto call_with_callback(F&& f, Args&&... args) {
         friend detail::future_caller;
 
     public:
-        future(CB cb, AT&& at, F&& f)
-            : cb_(cb), at_(std::move(at)), f_(std::forward<F>(f)) {}
+        future(CBS&& cbs, AT&& at, F&& f)
+            : cbs_(std::move(cbs)), at_(std::move(at)), f_(std::forward<F>(f)) {}
     };
 
-    return future(cb, std::move(argsTuple), std::forward<F>(f));
+    return future(std::move(cbs), std::move(argsTuple), std::forward<F>(f));
 }
 
 } // namespace sco
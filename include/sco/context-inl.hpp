@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef SCO_HEADER_ONLY
+# include <sco/context.hpp>
+#endif
+
+namespace sco {
+
+SCO_INLINE context_base* context_base::find(const void* type) noexcept {
+    auto* ctx = this;
+    while (ctx && ctx->type_ != type) {
+        ctx = ctx->outer_;
+    }
+    return ctx;
+}
+
+namespace detail {
+
+SCO_INLINE bool context_access::bind(promise_type_base* promise, context_base& ctx) {
+    if (!promise || promise->context_ == &ctx) {
+        return true;
+    }
+    // rebinding an outer context would link it to itself.
+    for (auto* outer = promise->context_; outer; outer = outer->outer_) {
+        if (outer == &ctx) {
+            return false;
+        }
+    }
+    ctx.outer_ = promise->context_;
+    promise->context_ = &ctx;
+    return true;
+}
+
+SCO_INLINE void context_access::restore(promise_type_base* promise, context_base* previous) noexcept {
+    promise->context_ = previous;
+}
+
+SCO_INLINE context_base* context_access::current(promise_type_base* promise) {
+    return promise ? promise->context_ : nullptr;
+}
+
+} // namespace detail
+} // namespace sco
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <sco/promise.hpp>
+
+#include <stdexcept>
+#include <utility>
+
+namespace sco {
+
+// The base of the contexts, e.g. a trace id, a deadline or a tenant.
+// A context bound by a coroutine is reached by the coroutines it awaits,
+// through a pointer copied into every child frame when it is awaited.
+// The lookup walks the bound contexts from the innermost, one key compare each,
+// there are rarely more than a few, so a table per frame would cost more to copy than the walk.
+class context_base {
+private:
+    const void* type_;
+    // the context bound before this one, found when the types differ.
+    context_base* outer_{};
+
+    friend detail::context_access;
+
+protected:
+    explicit context_base(const void* type) noexcept: type_(type) {}
+
+public:
+    context_base(const context_base&) = delete;
+    context_base& operator=(const context_base&) = delete;
+
+    // The innermost context of the type, this one or an outer one.
+    context_base* find(const void* type) noexcept;
+};
+
+// The context holding a T, it must outlive the coroutines it is bound to,
+// e.g. a local variable of the root coroutine.
+// ```c++
+// sco::context<request_info> ctx{req->GetHeader("X-Request-Id")};
+// auto bound = co_await sco::bind_context(ctx);
+// ...
+// auto* info = co_await sco::this_context<request_info>(); // in any awaited child
+// ```
+template<typename T>
+class context: public context_base {
+private:
+    inline static const char type_tag{};
+
+    T value_;
+
+public:
+    template<typename... Args>
+    explicit context(Args&&... args): context_base(type()), value_(std::forward<Args>(args)...) {}
+
+    // The key of the context, one per type.
+    static const void* type() noexcept { return &type_tag; }
+
+    T& get() noexcept { return value_; }
+    T& operator*() noexcept { return value_; }
+    T* operator->() noexcept { return &value_; }
+};
+
+namespace detail {
+
+struct context_access {
+    // Bind ctx to the awaiting coroutine, the outer context stays reachable.
+    // False if ctx is already an outer context of the coroutine.
+    static bool bind(promise_type_base* promise, context_base& ctx);
+    static void restore(promise_type_base* promise, context_base* previous) noexcept;
+    static context_base* current(promise_type_base* promise);
+};
+
+} // namespace detail
+
+// Returned by bind_context, restores the previous context of the coroutine when destroyed.
+class [[nodiscard]] context_binding {
+private:
+    detail::promise_type_base* promise_{};
+    context_base* previous_{};
+
+public:
+    context_binding() = default;
+    context_binding(detail::promise_type_base* promise, context_base* previous) noexcept:
+        promise_(promise), previous_(previous) {}
+    context_binding(context_binding&& other) noexcept:
+        promise_(std::exchange(other.promise_, nullptr)), previous_(other.previous_) {}
+    context_binding& operator=(context_binding&& other) noexcept {
+        if (this != &other) {
+            unbind();
+            promise_ = std::exchange(other.promise_, nullptr);
+            previous_ = other.previous_;
+        }
+        return *this;
+    }
+    context_binding(const context_binding&) = delete;
+    context_binding& operator=(const context_binding&) = delete;
+
+    ~context_binding() { unbind(); }
+
+    // Restore the context bound before, the bindings are released in the reverse order.
+    void unbind() noexcept {
+        if (auto* promise = std::exchange(promise_, nullptr)) {
+            detail::context_access::restore(promise, previous_);
+        }
+    }
+};
+
+namespace detail {
+
+// The Futures reading and writing the context of the awaiting coroutine,
+// they complete without suspending.
+class bind_context_future: protected future_base,
+    protected future_with_sync,
+    protected future_with_value<context_binding> {
+private:
+    context_base& ctx_;
+
+    void resume() {
+        auto* promise = sync_->promise;
+        auto* previous = context_access::current(promise);
+        if (!context_access::bind(promise, ctx_)) {
+            exception_ = std::make_exception_ptr(std::logic_error("sco context already bound"));
+        } else if (promise && previous != &ctx_) {
+            this->value_.emplace(promise, previous);
+        } else {
+            this->value_.emplace();
+        }
+        sync_->release_and_check_await_done();
+    }
+
+    friend future_caller;
+
+public:
+    explicit bind_context_future(context_base& ctx): ctx_(ctx) {}
+};
+
+template<typename T>
+class this_context_future: protected future_base,
+    protected future_with_sync,
+    protected future_with_value<T*> {
+private:
+    void resume() {
+        auto* ctx = context_access::current(sync_->promise);
+        ctx = ctx ? ctx->find(context<T>::type()) : nullptr;
+        this->value_ = ctx ? &static_cast<context<T>*>(ctx)->get() : nullptr;
+        sync_->release_and_check_await_done();
+    }
+
+    friend future_caller;
+};
+
+} // namespace detail
+
+// Bind the context to the awaiting coroutine and the coroutines it awaits from now on,
+// until the returned context_binding is destroyed, keep it in the same scope as the context.
+// Binding a context that is already an outer context of the coroutine throws std::logic_error.
+// The detached legs of all_or_fail, hedge and retry with an attempt timeout may outlive the awaiting coroutine,
+// they do not see the context.
+inline auto bind_context(context_base& ctx) {
+    return detail::bind_context_future(ctx);
+}
+
+// The innermost context<T> bound to the awaiting coroutine or its parents, nullptr if none.
+template<typename T>
+auto this_context() {
+    return detail::this_context_future<T>();
+}
+
+} // namespace sco
+
+#ifdef SCO_HEADER_ONLY
+# include <sco/context-inl.hpp>
+#endif
@@ -0,0 +1,315 @@
+#pragma once
+
+#ifndef SCO_HEADER_ONLY
+# include <sco/executor.hpp>
+#endif
+
+namespace sco {
+namespace detail {
+
+SCO_INLINE bool mpsc_queue::push(task* t) {
+    auto* head = head_.load(std::memory_order_relaxed);
+    do {
+        t->next_ = head;
+    } while (!head_.compare_exchange_weak(head, t, std::memory_order_release, std::memory_order_relaxed));
+    return head == nullptr;
+}
+
+SCO_INLINE task* mpsc_queue::pop_all() {
+    auto* head = head_.exchange(nullptr, std::memory_order_acquire);
+
+    // the stack is LIFO, reverse it.
+    task* ret{};
+    while (head) {
+        auto* next = head->next_;
+        head->next_ = ret;
+        ret = head;
+        head = next;
+    }
+    return ret;
+}
+
+SCO_INLINE bool mpsc_queue::empty() const {
+    return head_.load(std::memory_order_acquire) == nullptr;
+}
+
+SCO_INLINE executor*& this_thread_executor() {
+    static thread_local executor* ret{};
+    return ret;
+}
+
+} // namespace detail
+
+SCO_INLINE executor* executor::current() {
+    return detail::this_thread_executor();
+}
+
+SCO_INLINE executor::current_scope::current_scope(executor* ex): prev(detail::this_thread_executor()) {
+    detail::this_thread_executor() = ex;
+}
+
+SCO_INLINE executor::current_scope::~current_scope() {
+    detail::this_thread_executor() = prev;
+}
+
+namespace detail {
+
+// Wait until the posts that have published their task stop touching the executor.
+SCO_INLINE void wait_posting(const std::atomic_uint32_t& posting) {
+    while (posting.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+} // namespace detail
+
+SCO_INLINE loop_executor::loop_executor(std::function<void()> wake): wake_(std::move(wake)) {}
+
+SCO_INLINE loop_executor::~loop_executor() {
+    detail::wait_posting(posting_);
+}
+
+SCO_INLINE void loop_executor::post(detail::task* t) {
+    // once the task is published the owner may run it and destroy the executor,
+    // which waits for the count to drop.
+    posting_.fetch_add(1, std::memory_order_relaxed);
+    if (queue_.push(t)) {
+        signal_.fetch_add(1, std::memory_order_release);
+        signal_.notify_one();
+        if (wake_) {
+            wake_();
+        }
+    }
+    // otherwise the owner has not drained the previous tasks, it is awake.
+    posting_.fetch_sub(1, std::memory_order_release);
+}
+
+SCO_INLINE std::size_t loop_executor::poll() {
+    current_scope scope(this);
+
+    std::size_t n = 0;
+    std::exception_ptr ex;
+    for (auto* t = queue_.pop_all(); t;) {
+        auto* next = t->next_;
+        try {
+            t->run_(t);
+        } catch (...) {
+            if (!ex) {
+                ex = std::current_exception();
+            }
+        }
+        t = next;
+        ++n;
+    }
+
+    if (ex) {
+        std::rethrow_exception(ex);
+    }
+    return n;
+}
+
+SCO_INLINE void loop_executor::run() {
+    while (!stopped_.load(std::memory_order_acquire)) {
+        auto s = signal_.load(std::memory_order_acquire);
+        if (poll() == 0 && queue_.empty()) {
+            signal_.wait(s, std::memory_order_acquire);
+        }
+    }
+    // the completions posted before stop.
+    poll();
+}
+
+SCO_INLINE void loop_executor::stop() {
+    stopped_.store(true, std::memory_order_release);
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_one();
+}
+
+SCO_INLINE void priority_executor::lane_executor::post(detail::task* t) {
+    auto* owner = owner_;
+    owner->posting_.fetch_add(1, std::memory_order_relaxed);
+    if (queue_.push(t)) {
+        owner->notify();
+    }
+    owner->posting_.fetch_sub(1, std::memory_order_release);
+}
+
+SCO_INLINE void priority_executor::lane_executor::refill() {
+    if (queue_.empty()) {
+        return;
+    }
+    auto* t = queue_.pop_all();
+    if (tail_) {
+        tail_->next_ = t;
+    } else {
+        head_ = t;
+    }
+    for (tail_ = t; tail_->next_;) {
+        tail_ = tail_->next_;
+    }
+}
+
+SCO_INLINE void priority_executor::lane_executor::run_front() {
+    auto* t = head_;
+    head_ = t->next_;
+    if (!head_) {
+        tail_ = nullptr;
+    }
+
+    current_scope scope(this);
+    t->run_(t);
+}
+
+SCO_INLINE priority_executor::priority_executor(std::size_t levels, std::size_t max_bypass, std::function<void()> wake):
+    lanes_(new lane_executor[levels == 0 ? 1 : levels]), levels_(levels == 0 ? 1 : levels),
+    max_bypass_(max_bypass), wake_(std::move(wake)) {
+    for (std::size_t i = 0; i < levels_; ++i) {
+        lanes_[i].owner_ = this;
+    }
+}
+
+SCO_INLINE priority_executor::~priority_executor() {
+    detail::wait_posting(posting_);
+}
+
+SCO_INLINE executor& priority_executor::lane(std::size_t level) {
+    return lanes_[level < levels_ ? level : levels_ - 1];
+}
+
+SCO_INLINE void priority_executor::notify() {
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_one();
+    if (wake_) {
+        wake_();
+    }
+}
+
+SCO_INLINE priority_executor::lane_executor* priority_executor::pick() {
+    // the new tasks of higher levels go ahead of the waiting ones.
+    for (std::size_t i = 0; i < levels_; ++i) {
+        lanes_[i].refill();
+    }
+
+    // a lower level that has been bypassed too often runs first.
+    for (std::size_t i = levels_; i-- > 1;) {
+        auto& ln = lanes_[i];
+        if (ln.head_ && ln.bypassed_ >= max_bypass_) {
+            ln.bypassed_ = 0;
+            return &ln;
+        }
+    }
+
+    for (std::size_t i = 0; i < levels_; ++i) {
+        if (!lanes_[i].head_) {
+            continue;
+        }
+        lanes_[i].bypassed_ = 0;
+        for (std::size_t j = i + 1; j < levels_; ++j) {
+            if (lanes_[j].head_) {
+                ++lanes_[j].bypassed_;
+            }
+        }
+        return &lanes_[i];
+    }
+    return nullptr;
+}
+
+SCO_INLINE std::size_t priority_executor::poll() {
+    std::size_t n = 0;
+    std::exception_ptr ex;
+    while (auto* ln = pick()) {
+        try {
+            ln->run_front();
+        } catch (...) {
+            if (!ex) {
+                ex = std::current_exception();
+            }
+        }
+        ++n;
+    }
+
+    if (ex) {
+        std::rethrow_exception(ex);
+    }
+    return n;
+}
+
+SCO_INLINE void priority_executor::run() {
+    while (!stopped_.load(std::memory_order_acquire)) {
+        auto s = signal_.load(std::memory_order_acquire);
+        if (poll() == 0) {
+            signal_.wait(s, std::memory_order_acquire);
+        }
+    }
+    // the completions posted before stop.
+    poll();
+}
+
+SCO_INLINE void priority_executor::stop() {
+    stopped_.store(true, std::memory_order_release);
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_one();
+}
+
+SCO_INLINE thread_pool::thread_pool(std::size_t n) {
+    if (n == 0) {
+        n = 1;
+    }
+    threads_.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        threads_.emplace_back([this] { worker(); });
+    }
+}
+
+SCO_INLINE thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : threads_) {
+        t.join();
+    }
+}
+
+SCO_INLINE void thread_pool::post(detail::task* t) {
+    t->next_ = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (tail_) {
+            tail_->next_ = t;
+        } else {
+            head_ = t;
+        }
+        tail_ = t;
+    }
+    cv_.notify_one();
+}
+
+SCO_INLINE void thread_pool::worker() {
+    current_scope scope(this);
+
+    for (;;) {
+        detail::task* t{};
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return head_ || stopped_; });
+            if (!head_) {
+                return;
+            }
+            t = head_;
+            head_ = t->next_;
+            if (!head_) {
+                tail_ = nullptr;
+            }
+        }
+
+        try {
+            t->run_(t);
+        } catch (...) { // NOLINT(bugprone-empty-catch)
+            // the exception of a root coroutine finished here has no caller to go to.
+        }
+    }
+}
+
+} // namespace sco
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <sco/common.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sco {
+namespace detail {
+
+// The intrusive node scheduled by executors.
+struct task {
+    task* next_{};
+    void (*run_)(task*){};
+};
+
+// A task owning a callable, deletes itself after running.
+template<typename F>
+struct function_task: public task {
+    F f_;
+
+    explicit function_task(F&& f): f_(std::move(f)) {
+        run_ = [](task* t) {
+            std::unique_ptr<function_task> self(static_cast<function_task*>(t));
+            self->f_();
+        };
+    }
+};
+
+// Lock-free multi-producer single-consumer queue of intrusive tasks.
+class mpsc_queue {
+private:
+    std::atomic<task*> head_{};
+
+public:
+    // Returns true if the queue was empty, any thread.
+    bool push(task* t);
+
+    // Take all the tasks in FIFO order, consumer thread only.
+    task* pop_all();
+
+    bool empty() const;
+};
+
+} // namespace detail
+
+// The interface of the executors that coroutines can be resumed on.
+class executor {
+public:
+    executor() = default;
+    virtual ~executor() = default;
+    executor(const executor&) = delete;
+    executor& operator=(const executor&) = delete;
+    executor(executor&&) = delete;
+    executor& operator=(executor&&) = delete;
+
+    // Schedule the task, can be called from any thread.
+    virtual void post(detail::task* t) = 0;
+
+    // Schedule a callable.
+    template<typename F>
+    void execute(F&& f) {
+        post(new detail::function_task<std::decay_t<F>>(std::decay_t<F>(std::forward<F>(f))));
+    }
+
+    // The executor whose tasks are running in the current thread.
+    static executor* current();
+
+protected:
+    // Mark the current thread as running the tasks of this executor.
+    struct current_scope {
+        executor* prev;
+        explicit current_scope(executor* ex);
+        ~current_scope();
+        current_scope(const current_scope&) = delete;
+        current_scope& operator=(const current_scope&) = delete;
+        current_scope(current_scope&&) = delete;
+        current_scope& operator=(current_scope&&) = delete;
+    };
+};
+
+// An executor owned by one thread, e.g. an event loop.
+// Other threads only publish tasks into a lock-free queue and wake the owner,
+// the tasks run when the owner calls poll() or run().
+class loop_executor: public executor {
+private:
+    detail::mpsc_queue queue_;
+    std::atomic_uint32_t signal_{};
+    std::atomic_bool stopped_{};
+    // the posts still touching the executor after publishing their task.
+    std::atomic_uint32_t posting_{};
+    std::function<void()> wake_;
+
+public:
+    loop_executor() = default;
+
+    // wake is called when a task is posted into the empty queue,
+    // use it to integrate with the owner's event loop (eventfd, uv_async_send, etc.)
+    explicit loop_executor(std::function<void()> wake);
+
+    // Waits for the posts in progress in other threads, which may still be signalling
+    // after the owner has run their tasks.
+    ~loop_executor() override;
+
+    void post(detail::task* t) override;
+
+    // Run the pending tasks, returns the number of tasks run.
+    // The first exception thrown by a task is rethrown after the others have run.
+    std::size_t poll();
+
+    // Run the tasks until stop() is called, waiting on a futex while idle,
+    // the tasks posted before stop() are run before it returns.
+    void run();
+
+    void stop();
+};
+
+// An executor owned by one thread like loop_executor, with one run queue per priority level.
+// A root started on a lane passes it to its children, so all of their completions
+// are queued at the priority of the root.
+// Level 0 runs first, a task waiting in a lower level runs after at most max_bypass tasks of higher levels.
+// ```c++
+// sco::priority_executor io(2);
+// handle_get(req).start_root_in_this_thread(io.lane(0));
+// refresh_cache(key).start_root_in_this_thread(io.lane(1));
+// io.run();
+// ```
+class priority_executor {
+public:
+    class lane_executor: public executor {
+    private:
+        priority_executor* owner_{};
+        detail::mpsc_queue queue_;
+
+        // the tasks taken from the queue, owner thread only.
+        detail::task* head_{};
+        detail::task* tail_{};
+        std::size_t bypassed_{};
+
+        void refill();
+        void run_front();
+
+        friend priority_executor;
+
+    public:
+        void post(detail::task* t) override;
+    };
+
+private:
+    std::unique_ptr<lane_executor[]> lanes_;
+    std::size_t levels_;
+    std::size_t max_bypass_;
+    std::atomic_uint32_t signal_{};
+    std::atomic_bool stopped_{};
+    // the posts still touching the executor after publishing their task.
+    std::atomic_uint32_t posting_{};
+    std::function<void()> wake_;
+
+public:
+    explicit priority_executor(std::size_t levels = 2, std::size_t max_bypass = 16, std::function<void()> wake = {});
+
+    // Waits for the posts in progress in other threads, like loop_executor.
+    ~priority_executor();
+
+    // The executor of a priority level, 0 is the highest.
+    executor& lane(std::size_t level);
+
+    std::size_t levels() const noexcept { return levels_; }
+
+    // Run the pending tasks by priority, returns the number of tasks run.
+    // The first exception thrown by a task is rethrown after the others have run.
+    std::size_t poll();
+
+    // Run the tasks until stop() is called, waiting on a futex while idle,
+    // the tasks posted before stop() are run before it returns.
+    void run();
+
+    void stop();
+
+private:
+    void notify();
+    lane_executor* pick();
+};
+
+// A fixed-size pool of threads sharing one FIFO queue,
+// for CPU-bound work that should not run in the I/O threads.
+class thread_pool: public executor {
+private:
+    std::mutex mu_;
+    std::condition_variable cv_;
+    detail::task* head_{};
+    detail::task* tail_{};
+    bool stopped_{};
+    std::vector<std::thread> threads_;
+
+public:
+    explicit thread_pool(std::size_t n = std::thread::hardware_concurrency());
+
+    // The pending tasks are run before the threads exit.
+    ~thread_pool() override;
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    thread_pool(thread_pool&&) = delete;
+    thread_pool& operator=(thread_pool&&) = delete;
+
+    void post(detail::task* t) override;
+
+    std::size_t size() const noexcept { return threads_.size(); }
+
+private:
+    void worker();
+};
+
+} // namespace sco
+
+#ifdef SCO_HEADER_ONLY
+# include <sco/executor-inl.hpp>
+#endif
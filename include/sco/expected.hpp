@@ -0,0 +1,146 @@
+#pragma once
+
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace sco {
+
+// The error wrapper used to construct an expected holding an error.
+template<typename E>
+class unexpected {
+private:
+    E error_;
+
+public:
+    template<typename G = E, std::enable_if_t<std::is_constructible_v<E, G&&>>* = nullptr>
+    constexpr explicit unexpected(G&& e): error_(std::forward<G>(e)) {}
+
+    constexpr E& error() & noexcept { return error_; }
+    constexpr const E& error() const& noexcept { return error_; }
+    constexpr E&& error() && noexcept { return std::move(error_); }
+};
+
+template<typename E>
+unexpected(E) -> unexpected<E>;
+
+// Thrown by expected::value() when it holds an error.
+template<typename E>
+class bad_expected_access: public std::exception {
+private:
+    E error_;
+
+public:
+    explicit bad_expected_access(E e): error_(std::move(e)) {}
+
+    const char* what() const noexcept override { return "bad expected access"; }
+    const E& error() const noexcept { return error_; }
+};
+
+// A value or an error, returned by coroutines whose failures are routine,
+// `co_await` of an error short-circuits the coroutine without throwing.
+template<typename T, typename E>
+class expected {
+private:
+    std::variant<T, unexpected<E>> v_;
+
+public:
+    using value_type = T;
+    using error_type = E;
+
+    template<typename U = T, std::enable_if_t<std::is_default_constructible_v<U>>* = nullptr>
+    constexpr expected() {}
+
+    template<typename U = T, std::enable_if_t<
+        std::is_constructible_v<T, U&&> &&
+        !std::is_same_v<std::remove_cvref_t<U>, expected>
+    >* = nullptr>
+    constexpr expected(U&& v): v_(std::in_place_index<0>, std::forward<U>(v)) {} // NOLINT(google-explicit-constructor)
+
+    template<typename G, std::enable_if_t<std::is_constructible_v<E, G&&>>* = nullptr>
+    constexpr expected(unexpected<G>&& e): v_(std::in_place_index<1>, std::move(e).error()) {} // NOLINT(google-explicit-constructor)
+
+    template<typename G, std::enable_if_t<std::is_constructible_v<E, const G&>>* = nullptr>
+    constexpr expected(const unexpected<G>& e): v_(std::in_place_index<1>, e.error()) {} // NOLINT(google-explicit-constructor)
+
+    constexpr bool has_value() const noexcept { return v_.index() == 0; }
+    constexpr explicit operator bool() const noexcept { return has_value(); }
+
+    constexpr T& value() & { check(); return std::get<0>(v_); }
+    constexpr const T& value() const& { check(); return std::get<0>(v_); }
+    constexpr T&& value() && { check(); return std::move(std::get<0>(v_)); }
+
+    constexpr T& operator*() & noexcept { return *std::get_if<0>(&v_); }
+    constexpr const T& operator*() const& noexcept { return *std::get_if<0>(&v_); }
+    constexpr T&& operator*() && noexcept { return std::move(*std::get_if<0>(&v_)); }
+    constexpr T* operator->() noexcept { return std::get_if<0>(&v_); }
+    constexpr const T* operator->() const noexcept { return std::get_if<0>(&v_); }
+
+    constexpr E& error() & noexcept { return std::get_if<1>(&v_)->error(); }
+    constexpr const E& error() const& noexcept { return std::get_if<1>(&v_)->error(); }
+    constexpr E&& error() && noexcept { return std::move(std::get_if<1>(&v_)->error()); }
+
+    template<typename U>
+    constexpr T value_or(U&& v) const& {
+        return has_value() ? **this : static_cast<T>(std::forward<U>(v));
+    }
+
+private:
+    constexpr void check() const {
+        if (!has_value()) {
+            throw bad_expected_access<E>(error());
+        }
+    }
+};
+
+// Specialization for void value type.
+template<typename E>
+class expected<void, E> {
+private:
+    std::optional<E> error_;
+
+public:
+    using value_type = void;
+    using error_type = E;
+
+    constexpr expected() noexcept = default;
+
+    template<typename G, std::enable_if_t<std::is_constructible_v<E, G&&>>* = nullptr>
+    constexpr expected(unexpected<G>&& e): error_(std::move(e).error()) {} // NOLINT(google-explicit-constructor)
+
+    template<typename G, std::enable_if_t<std::is_constructible_v<E, const G&>>* = nullptr>
+    constexpr expected(const unexpected<G>& e): error_(e.error()) {} // NOLINT(google-explicit-constructor)
+
+    constexpr bool has_value() const noexcept { return !error_; }
+    constexpr explicit operator bool() const noexcept { return has_value(); }
+
+    constexpr void value() const {
+        if (error_) {
+            throw bad_expected_access<E>(*error_);
+        }
+    }
+    constexpr void operator*() const noexcept {}
+
+    // NOLINTBEGIN(bugprone-unchecked-optional-access)
+    constexpr E& error() & noexcept { return *error_; }
+    constexpr const E& error() const& noexcept { return *error_; }
+    constexpr E&& error() && noexcept { return std::move(*error_); }
+    // NOLINTEND(bugprone-unchecked-optional-access)
+};
+
+namespace detail {
+
+template<typename T>
+struct is_expected: public std::false_type {};
+
+template<typename T, typename E>
+struct is_expected<expected<T, E>>: public std::true_type {};
+
+template<typename T>
+constexpr bool is_expected_v = is_expected<std::remove_cvref_t<T>>::value;
+
+} // namespace detail
+
+} // namespace sco
@@ -30,7 +30,7 @@ struct future_base: private future_nocopy {
 };
 
 struct future_with_sync {
-    sync_object sync_;
+    sync_object sync_{};
 
     void set_sync_object(const sync_object& sync);
 };
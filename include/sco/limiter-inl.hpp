@@ -0,0 +1,217 @@
+#pragma once
+
+#ifndef SCO_HEADER_ONLY
+# include <sco/limiter.hpp>
+#endif
+
+#include <algorithm>
+#include <optional>
+
+namespace sco {
+
+SCO_INLINE void adaptive_limiter::permit::release(bool dropped) {
+    if (auto* l = std::exchange(limiter_, nullptr)) {
+        l->leave(std::chrono::steady_clock::now() - start_, dropped);
+    }
+}
+
+SCO_INLINE adaptive_limiter::adaptive_limiter(options opts): opts_(opts),
+    limit_(static_cast<std::size_t>(opts.initial_limit)), limit_value_(opts.initial_limit) {}
+
+SCO_INLINE bool adaptive_limiter::try_enter() noexcept {
+    auto n = in_flight_.load(std::memory_order_seq_cst);
+    while (n < limit_.load(std::memory_order_relaxed)) {
+        if (in_flight_.compare_exchange_weak(n, n + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SCO_INLINE bool adaptive_limiter::enter(waiter& w) {
+    // the lock-free fast path, unless others are waiting.
+    if (waiting_.load(std::memory_order_seq_cst) == 0 && try_enter()) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mu_);
+    waiting_.fetch_add(1, std::memory_order_seq_cst);
+    // a permit may have been released before waiting_ was seen.
+    if (!head_ && try_enter()) {
+        waiting_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (tail_) {
+        tail_->next = &w;
+    } else {
+        head_ = &w;
+    }
+    tail_ = &w;
+    return false;
+}
+
+SCO_INLINE void adaptive_limiter::leave(std::chrono::nanoseconds rtt, bool dropped) {
+    in_flight_.fetch_sub(1, std::memory_order_seq_cst);
+
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (min_rtt_.count() == 0 || rtt < min_rtt_ || ++samples_ >= opts_.probe_interval) {
+            min_rtt_ = rtt;
+            samples_ = 0;
+        }
+
+        if (dropped || static_cast<double>(rtt.count()) > opts_.tolerance * static_cast<double>(min_rtt_.count())) {
+            limit_value_ = std::max(opts_.min_limit, limit_value_ * opts_.backoff);
+        } else if (static_cast<double>(in_flight_.load(std::memory_order_relaxed) + 1) * 2 >= limit_value_) {
+            // only grow while the limit is used.
+            limit_value_ = std::min(opts_.max_limit, limit_value_ + 1 / limit_value_);
+        }
+        limit_.store(static_cast<std::size_t>(limit_value_), std::memory_order_relaxed);
+    }
+
+    if (waiting_.load(std::memory_order_seq_cst) != 0) {
+        dispatch();
+    }
+}
+
+SCO_INLINE void adaptive_limiter::dispatch() {
+    waiter* ready{};
+    waiter* last{};
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        while (head_ && try_enter()) {
+            auto* w = head_;
+            head_ = w->next;
+            if (!head_) {
+                tail_ = nullptr;
+            }
+            waiting_.fetch_sub(1, std::memory_order_relaxed);
+
+            w->next = nullptr;
+            if (last) {
+                last->next = w;
+            } else {
+                ready = w;
+            }
+            last = w;
+        }
+    }
+
+    // resume outside of the lock, the waiter is gone after its resume.
+    while (ready) {
+        auto* next = ready->next;
+        ready->cb.resume();
+        ready = next;
+    }
+}
+
+SCO_INLINE rate_limiter::rate_limiter(double rate, std::size_t burst, timer_function set_timer):
+    interval_(std::max<std::int64_t>(1, static_cast<std::int64_t>(1e9 / rate))),
+    burst_(static_cast<std::int64_t>(std::max<std::size_t>(burst, 1))),
+    set_timer_(std::move(set_timer)) {}
+
+SCO_INLINE std::int64_t rate_limiter::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SCO_INLINE bool rate_limiter::try_take(std::int64_t tokens, std::int64_t now) {
+    auto tat = tat_.load(std::memory_order_relaxed);
+    for (;;) {
+        auto next = std::max(tat, now) + tokens * interval_;
+        // more than burst is taken from a full bucket, the debt delays the next calls.
+        if (next - now > burst_ * interval_ && (tokens <= burst_ || tat > now)) {
+            return false;
+        }
+        if (tat_.compare_exchange_weak(tat, next, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+SCO_INLINE bool rate_limiter::enter(waiter& w) {
+    auto t = now();
+    // the lock-free fast path, unless others are waiting.
+    if (waiting_.load(std::memory_order_acquire) == 0 && try_take(w.tokens, t)) {
+        return true;
+    }
+
+    std::optional<std::chrono::nanoseconds> delay;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!head_ && try_take(w.tokens, t)) {
+            return true;
+        }
+
+        waiting_.fetch_add(1, std::memory_order_release);
+        if (tail_) {
+            tail_->next = &w;
+        } else {
+            head_ = &w;
+        }
+        tail_ = &w;
+
+        if (!armed_) {
+            delay = arm(t);
+        }
+    }
+
+    if (delay) {
+        set_timer_(*delay, [this] { on_timer(); });
+    }
+    return false;
+}
+
+SCO_INLINE std::chrono::nanoseconds rate_limiter::arm(std::int64_t now) {
+    // the time when the tokens of the first waiter are available, the full bucket for more than burst.
+    auto tokens = std::min(head_->tokens, burst_);
+    auto at = tat_.load(std::memory_order_relaxed) + (tokens - burst_) * interval_;
+    armed_ = true;
+    return std::chrono::nanoseconds(std::max<std::int64_t>(at - now, 0));
+}
+
+SCO_INLINE void rate_limiter::on_timer() {
+    waiter* ready{};
+    waiter* last{};
+    std::optional<std::chrono::nanoseconds> delay;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        armed_ = false;
+
+        auto t = now();
+        while (head_ && try_take(head_->tokens, t)) {
+            auto* w = head_;
+            head_ = w->next;
+            if (!head_) {
+                tail_ = nullptr;
+            }
+            waiting_.fetch_sub(1, std::memory_order_release);
+
+            w->next = nullptr;
+            if (last) {
+                last->next = w;
+            } else {
+                ready = w;
+            }
+            last = w;
+        }
+
+        if (head_) {
+            delay = arm(t);
+        }
+    }
+
+    if (delay) {
+        set_timer_(*delay, [this] { on_timer(); });
+    }
+
+    // resume the batch outside of the lock.
+    while (ready) {
+        auto* next = ready->next;
+        ready->cb.resume();
+        ready = next;
+    }
+}
+
+} // namespace sco
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <sco/callback.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace sco {
+
+// A concurrency limit adjusted by the round-trip time of each call with AIMD:
+// the limit grows by about one per round trip while the calls are as fast as the fastest seen,
+// and is multiplied by backoff when they get slower than tolerance times that, or are dropped.
+// The coroutines over the limit wait in FIFO order.
+// ```c++
+// sco::adaptive_limiter limiter;
+// auto permit = co_await limiter.acquire();
+// co_await sco::call_with_callback(...);
+// // the round trip is recorded when the permit is released.
+// ```
+class adaptive_limiter {
+public:
+    struct options {
+        double initial_limit = 20;
+        double min_limit = 1;
+        double max_limit = 1000;
+        // the decrease factor.
+        double backoff = 0.9;
+        // the calls slower than tolerance * min_rtt are treated as congestion.
+        double tolerance = 2.0;
+        // min_rtt is measured again after this many calls, to follow the upstream.
+        std::size_t probe_interval = 1000;
+    };
+
+    // Held while the call is in flight, released when destroyed.
+    class permit {
+    private:
+        adaptive_limiter* limiter_{};
+        std::chrono::steady_clock::time_point start_;
+
+    public:
+        permit() = default;
+        explicit permit(adaptive_limiter* limiter):
+            limiter_(limiter), start_(std::chrono::steady_clock::now()) {}
+
+        permit(permit&& other) noexcept:
+            limiter_(std::exchange(other.limiter_, nullptr)), start_(other.start_) {}
+        permit& operator=(permit&& other) noexcept {
+            if (this != &other) {
+                release();
+                limiter_ = std::exchange(other.limiter_, nullptr);
+                start_ = other.start_;
+            }
+            return *this;
+        }
+        permit(const permit&) = delete;
+        permit& operator=(const permit&) = delete;
+
+        ~permit() { release(); }
+
+        // dropped: the call failed from overload, e.g. timed out or rejected.
+        void release(bool dropped = false);
+
+        explicit operator bool() const noexcept { return limiter_ != nullptr; }
+    };
+
+private:
+    struct waiter {
+        detail::callback_base cb;
+        waiter* next{};
+    };
+
+    options opts_;
+    std::atomic_size_t limit_;
+    std::atomic_size_t in_flight_{};
+    std::atomic_size_t waiting_{};
+
+    std::mutex mu_;
+    waiter* head_{};
+    waiter* tail_{};
+    double limit_value_;
+    std::chrono::nanoseconds min_rtt_{};
+    std::size_t samples_{};
+
+public:
+    explicit adaptive_limiter(options opts);
+    adaptive_limiter(): adaptive_limiter(options{}) {}
+
+    adaptive_limiter(const adaptive_limiter&) = delete;
+    adaptive_limiter& operator=(const adaptive_limiter&) = delete;
+
+    // Wait until a call can be made, returns the permit.
+    auto acquire() {
+        class future: protected detail::future_base {
+        private:
+            adaptive_limiter* l_;
+            waiter w_;
+
+        private:
+            void set_sync_object(const detail::sync_object& sync) {
+                w_.cb.promise = sync;
+                w_.cb.exception = &exception_;
+            }
+
+            void resume() {
+                if (l_->enter(w_)) {
+                    w_.cb.resume();
+                }
+            }
+
+            permit return_value() { return permit(l_); }
+
+            friend detail::future_caller;
+
+        public:
+            explicit future(adaptive_limiter* l): l_(l) {}
+        };
+
+        return future(this);
+    }
+
+    std::size_t limit() const noexcept { return limit_.load(std::memory_order_relaxed); }
+    std::size_t in_flight() const noexcept { return in_flight_.load(std::memory_order_relaxed); }
+
+private:
+    bool try_enter() noexcept;
+    // Returns false if the waiter is queued.
+    bool enter(waiter& w);
+    void leave(std::chrono::nanoseconds rtt, bool dropped);
+    // Hand the free slots to the waiters.
+    void dispatch();
+};
+
+// A token bucket of rate tokens per second holding at most burst tokens,
+// the coroutines wait for their tokens instead of being rejected.
+// The tokens are taken with a lock-free CAS while no one is waiting,
+// the waiters are resumed in FIFO batches by a single timer, armed with set_timer.
+// The limiter must outlive the timer it has armed.
+// ```c++
+// sco::rate_limiter qps(100, 10, [](auto d, auto fn) { loop->setTimeout(ms(d), [fn](hv::TimerID) { fn(); }); });
+// co_await qps.acquire();
+// ```
+class rate_limiter {
+public:
+    using timer_function = std::function<void(std::chrono::nanoseconds, std::function<void()>)>;
+
+private:
+    struct waiter {
+        detail::callback_base cb;
+        std::int64_t tokens{};
+        waiter* next{};
+    };
+
+    std::int64_t interval_;
+    std::int64_t burst_;
+    timer_function set_timer_;
+
+    // the theoretical arrival time of the next token (GCRA), in steady_clock nanoseconds.
+    std::atomic<std::int64_t> tat_{};
+    std::atomic_size_t waiting_{};
+
+    std::mutex mu_;
+    waiter* head_{};
+    waiter* tail_{};
+    bool armed_{};
+
+public:
+    rate_limiter(double rate, std::size_t burst, timer_function set_timer);
+
+    rate_limiter(const rate_limiter&) = delete;
+    rate_limiter& operator=(const rate_limiter&) = delete;
+
+    // Wait for n tokens, all of them are charged,
+    // more than burst wait for a full bucket and delay the next calls until the rate is paid back.
+    auto acquire(std::size_t n = 1) {
+        class future: protected detail::future_base,
+            protected detail::future_with_value<void> {
+        private:
+            rate_limiter* l_;
+            waiter w_;
+
+        private:
+            void set_sync_object(const detail::sync_object& sync) {
+                w_.cb.promise = sync;
+                w_.cb.exception = &exception_;
+            }
+
+            void resume() {
+                if (l_->enter(w_)) {
+                    w_.cb.resume();
+                }
+            }
+
+            friend detail::future_caller;
+
+        public:
+            future(rate_limiter* l, std::int64_t n): l_(l) { w_.tokens = n; }
+        };
+
+        return future(this, static_cast<std::int64_t>(n));
+    }
+
+private:
+    static std::int64_t now();
+    bool try_take(std::int64_t tokens, std::int64_t now);
+    // Returns false if the waiter is queued.
+    bool enter(waiter& w);
+    // Lock held, returns the delay of the timer to set after unlocking.
+    std::chrono::nanoseconds arm(std::int64_t now);
+    void on_timer();
+};
+
+} // namespace sco
+
+#ifdef SCO_HEADER_ONLY
+# include <sco/limiter-inl.hpp>
+#endif
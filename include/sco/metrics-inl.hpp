@@ -0,0 +1,280 @@
+#pragma once
+
+#ifndef SCO_HEADER_ONLY
+# include <sco/metrics.hpp>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace sco {
+namespace detail {
+
+// Single writer counters, the readers only need the values to be untorn.
+SCO_INLINE void bump(std::atomic<std::uint64_t>& a, std::uint64_t n) noexcept {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// The histograms of one thread, indexed by site.
+struct latency_shard {
+    struct counters {
+        std::array<std::atomic<std::uint64_t>, latency_histogram::bucket_count> buckets{};
+        std::atomic<std::uint64_t> sum{};
+        std::atomic<std::uint64_t> max{};
+    };
+
+    // held by the owner only to add sites, and by the readers.
+    std::mutex mu;
+    std::vector<std::unique_ptr<counters>> sites;
+
+    latency_shard();
+    ~latency_shard();
+    latency_shard(const latency_shard&) = delete;
+    latency_shard& operator=(const latency_shard&) = delete;
+
+    counters& at(std::size_t site);
+    void merge_into(std::vector<latency_histogram>& out);
+    void merge_into(std::size_t site, latency_histogram& h);
+};
+
+struct latency_registry {
+    std::mutex mu;
+    std::unordered_map<std::string, std::size_t> ids;
+    std::vector<std::string> names;
+    std::vector<latency_shard*> shards;
+    // the counts of the threads that have exited.
+    std::vector<latency_histogram> retired;
+
+    static latency_registry& get();
+
+    std::size_t site(std::string name);
+};
+
+SCO_INLINE latency_registry& latency_registry::get() {
+    static latency_registry ret;
+    return ret;
+}
+
+SCO_INLINE std::size_t latency_registry::site(std::string name) {
+    std::lock_guard<std::mutex> lock(mu);
+    auto [it, inserted] = ids.emplace(name, names.size());
+    if (inserted) {
+        names.push_back(std::move(name));
+        retired.emplace_back();
+    }
+    return it->second;
+}
+
+SCO_INLINE latency_shard::latency_shard() {
+    auto& reg = latency_registry::get();
+    std::lock_guard<std::mutex> lock(reg.mu);
+    reg.shards.push_back(this);
+}
+
+SCO_INLINE latency_shard::~latency_shard() {
+    auto& reg = latency_registry::get();
+    std::lock_guard<std::mutex> lock(reg.mu);
+    reg.shards.erase(std::find(reg.shards.begin(), reg.shards.end(), this));
+    merge_into(reg.retired);
+}
+
+SCO_INLINE latency_shard::counters& latency_shard::at(std::size_t site) {
+    if (site >= sites.size() || !sites[site]) {
+        std::lock_guard<std::mutex> lock(mu);
+        if (site >= sites.size()) {
+            sites.resize(site + 1);
+        }
+        sites[site] = std::make_unique<counters>();
+    }
+    return *sites[site];
+}
+
+SCO_INLINE void latency_shard::merge_into(std::vector<latency_histogram>& out) {
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        merge_into(i, out[i]);
+    }
+}
+
+SCO_INLINE void latency_shard::merge_into(std::size_t site, latency_histogram& h) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (site >= sites.size() || !sites[site]) {
+        return;
+    }
+    const auto& c = *sites[site];
+    for (std::size_t b = 0; b < latency_histogram::bucket_count; ++b) {
+        auto n = c.buckets[b].load(std::memory_order_relaxed);
+        h.buckets_[b] += n;
+        h.count_ += n;
+    }
+    h.sum_ += c.sum.load(std::memory_order_relaxed);
+    h.max_ = std::max(h.max_, c.max.load(std::memory_order_relaxed));
+}
+
+SCO_INLINE latency_shard& this_thread_latency_shard() {
+    static thread_local latency_shard ret;
+    return ret;
+}
+
+SCO_INLINE void record_latency(std::size_t site, std::chrono::nanoseconds d) {
+    auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(d.count(), 0));
+    auto& c = this_thread_latency_shard().at(site);
+    bump(c.buckets[latency_histogram::bucket_of(ns)], 1);
+    bump(c.sum, ns);
+    if (ns > c.max.load(std::memory_order_relaxed)) {
+        c.max.store(ns, std::memory_order_relaxed);
+    }
+}
+
+SCO_INLINE std::size_t latency_site_of(const std::source_location& loc) {
+    struct key {
+        const char* file;
+        std::uint_least32_t line;
+        std::uint_least32_t column;
+        bool operator==(const key&) const = default;
+    };
+    struct key_hash {
+        std::size_t operator()(const key& k) const noexcept {
+            return std::hash<const void*>()(k.file) ^ (std::size_t{k.line} << 1) ^ (std::size_t{k.column} << 20);
+        }
+    };
+    // the callsites seen by this thread.
+    static thread_local std::unordered_map<key, std::size_t, key_hash> sites;
+
+    key k{loc.file_name(), loc.line(), loc.column()};
+    auto it = sites.find(k);
+    if (it != sites.end()) {
+        return it->second;
+    }
+    auto id = latency_registry::get().site(std::string(loc.file_name()) + ":" + std::to_string(loc.line()));
+    sites.emplace(k, id);
+    return id;
+}
+
+} // namespace detail
+
+SCO_INLINE std::size_t latency_histogram::bucket_of(std::uint64_t ns) noexcept {
+    if (ns < sub_count) {
+        return static_cast<std::size_t>(ns);
+    }
+    auto msb = static_cast<std::size_t>(63 - std::countl_zero(ns));
+    auto shift = msb - sub_bits;
+    return (shift + 1) * sub_count + static_cast<std::size_t>((ns >> shift) & (sub_count - 1));
+}
+
+SCO_INLINE std::uint64_t latency_histogram::bucket_value(std::size_t i) noexcept {
+    if (i < sub_count) {
+        return i;
+    }
+    auto shift = i / sub_count - 1;
+    auto sub = i % sub_count;
+    return ((sub_count + sub) << shift) + ((std::uint64_t{1} << shift) - 1);
+}
+
+SCO_INLINE void latency_histogram::record(std::chrono::nanoseconds d) noexcept {
+    auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(d.count(), 0));
+    ++buckets_[bucket_of(ns)];
+    ++count_;
+    sum_ += ns;
+    max_ = std::max(max_, ns);
+}
+
+SCO_INLINE void latency_histogram::merge(const latency_histogram& other) noexcept {
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+SCO_INLINE std::chrono::nanoseconds latency_histogram::quantile(double q) const noexcept {
+    if (count_ == 0) {
+        return {};
+    }
+    auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count_)));
+    rank = std::max<std::uint64_t>(rank, 1);
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::chrono::nanoseconds(std::min(bucket_value(i), max_));
+        }
+    }
+    return std::chrono::nanoseconds(max_);
+}
+
+SCO_INLINE latency_site::latency_site(std::string name): id_(detail::latency_registry::get().site(std::move(name))) {}
+
+SCO_INLINE void latency_site::record(std::chrono::nanoseconds d) const {
+    detail::record_latency(id_, d);
+}
+
+SCO_INLINE latency_histogram latency_site::snapshot() const {
+    auto& reg = detail::latency_registry::get();
+    std::lock_guard<std::mutex> lock(reg.mu);
+
+    auto ret = reg.retired[id_];
+    for (auto* shard : reg.shards) {
+        shard->merge_into(id_, ret);
+    }
+    return ret;
+}
+
+SCO_INLINE std::vector<latency_snapshot> latency_snapshots() {
+    auto& reg = detail::latency_registry::get();
+    std::lock_guard<std::mutex> lock(reg.mu);
+
+    auto merged = reg.retired;
+    for (auto* shard : reg.shards) {
+        shard->merge_into(merged);
+    }
+
+    std::vector<latency_snapshot> ret;
+    ret.reserve(merged.size());
+    for (std::size_t i = 0; i < merged.size(); ++i) {
+        ret.push_back({reg.names[i], std::move(merged[i])});
+    }
+    return ret;
+}
+
+SCO_INLINE std::string latency_prometheus(std::string_view metric) {
+    auto seconds = [](std::chrono::nanoseconds d) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.9g", std::chrono::duration<double>(d).count());
+        return std::string(buf);
+    };
+    auto label = [](const std::string& site) {
+        std::string ret;
+        for (char c : site) {
+            if (c == '"' || c == '\\') {
+                ret += '\\';
+            }
+            ret += c == '\n' ? ' ' : c;
+        }
+        return ret;
+    };
+
+    std::string out;
+    out.append("# TYPE ").append(metric).append(" summary\n");
+    for (const auto& [site, h] : latency_snapshots()) {
+        if (h.count() == 0) {
+            continue;
+        }
+        auto l = label(site);
+        for (const char* q : {"0.5", "0.9", "0.99", "0.999"}) {
+            out.append(metric).append("{site=\"").append(l).append("\",quantile=\"").append(q).append("\"} ")
+                .append(seconds(h.quantile(std::stod(q)))).append("\n");
+        }
+        out.append(metric).append("_sum{site=\"").append(l).append("\"} ").append(seconds(h.sum())).append("\n");
+        out.append(metric).append("_count{site=\"").append(l).append("\"} ").append(std::to_string(h.count())).append("\n");
+    }
+    return out;
+}
+
+} // namespace sco
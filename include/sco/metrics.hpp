@@ -0,0 +1,155 @@
+#pragma once
+
+#include <sco/future.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sco {
+namespace detail {
+
+struct latency_shard;
+struct latency_registry;
+
+} // namespace detail
+
+// A log-linear latency histogram in nanoseconds like HdrHistogram,
+// 16 sub-buckets per power of two, the error of a quantile is at most 1/16.
+class latency_histogram {
+public:
+    static constexpr std::size_t sub_bits = 4;
+    static constexpr std::size_t sub_count = std::size_t{1} << sub_bits;
+    static constexpr std::size_t bucket_count = (64 - sub_bits + 1) * sub_count;
+
+    static std::size_t bucket_of(std::uint64_t ns) noexcept;
+    // The highest value of the bucket.
+    static std::uint64_t bucket_value(std::size_t i) noexcept;
+
+private:
+    std::vector<std::uint64_t> buckets_ = std::vector<std::uint64_t>(bucket_count);
+    std::uint64_t count_{};
+    std::uint64_t sum_{};
+    std::uint64_t max_{};
+
+public:
+    void record(std::chrono::nanoseconds d) noexcept;
+    void merge(const latency_histogram& other) noexcept;
+
+    std::uint64_t count() const noexcept { return count_; }
+    std::chrono::nanoseconds sum() const noexcept { return std::chrono::nanoseconds(sum_); }
+    std::chrono::nanoseconds max() const noexcept { return std::chrono::nanoseconds(max_); }
+
+    // q in [0, 1], e.g. 0.99 for p99.
+    std::chrono::nanoseconds quantile(double q) const noexcept;
+
+    friend detail::latency_shard;
+    friend detail::latency_registry;
+};
+
+// A named place whose latency is recorded, define it once, e.g. as a static.
+// ```c++
+// static const sco::latency_site redis_get("redis_get_async");
+// co_await sco::timed(redis_get, sco::call_with_callback(...));
+// ```
+class latency_site {
+private:
+    std::size_t id_;
+
+public:
+    explicit latency_site(std::string name);
+
+    std::size_t id() const noexcept { return id_; }
+
+    // Record into the shard of the current thread.
+    void record(std::chrono::nanoseconds d) const;
+
+    // The histogram of this site merged from all the threads.
+    latency_histogram snapshot() const;
+};
+
+// The histograms of all the threads merged by site.
+struct latency_snapshot {
+    std::string site;
+    latency_histogram histogram;
+};
+
+std::vector<latency_snapshot> latency_snapshots();
+
+// The merged histograms in the Prometheus text format, as summaries in seconds.
+std::string latency_prometheus(std::string_view metric = "sco_await_latency_seconds");
+
+namespace detail {
+
+// The site of a co_await callsite, registered on first use in each thread.
+std::size_t latency_site_of(const std::source_location& loc);
+
+void record_latency(std::size_t site, std::chrono::nanoseconds d);
+
+// The Future that records the time from its start until the awaiting coroutine takes the result.
+template<typename FT>
+class timed_future {
+private:
+    FT fut_;
+    std::size_t site_;
+    std::chrono::steady_clock::time_point start_;
+    bool recorded_{};
+
+public:
+    timed_future(FT&& fut, std::size_t site): fut_(std::forward<FT>(fut)), site_(site) {}
+
+private:
+    int pending_count() { return future_caller::pending_count(fut_); }
+    void set_sync_object(const sync_object& sync) { future_caller::set_sync_object(fut_, sync); }
+
+    void resume() {
+        start_ = std::chrono::steady_clock::now();
+        future_caller::resume(fut_);
+    }
+
+    auto return_value() {
+        record();
+        return future_caller::return_value(fut_);
+    }
+
+    std::exception_ptr return_exception() {
+        record();
+        return future_caller::return_exception(fut_);
+    }
+
+    void record() {
+        if (!recorded_) {
+            recorded_ = true;
+            record_latency(site_, std::chrono::steady_clock::now() - start_);
+        }
+    }
+
+    friend future_caller;
+};
+
+} // namespace detail
+
+// Record the latency of a FutureLike under a named site.
+template<typename FT, std::enable_if_t<detail::is_future_v<FT>>* = nullptr>
+auto timed(const latency_site& site, FT&& fut) {
+    return detail::timed_future<FT>(std::forward<FT>(fut), site.id());
+}
+
+// Record the latency of a FutureLike under its co_await callsite.
+template<typename FT, std::enable_if_t<detail::is_future_v<FT>>* = nullptr>
+auto timed(FT&& fut, const std::source_location& loc = std::source_location::current()) {
+    return detail::timed_future<FT>(std::forward<FT>(fut), detail::latency_site_of(loc));
+}
+
+} // namespace sco
+
+#ifdef SCO_HEADER_ONLY
+# include <sco/metrics-inl.hpp>
+#endif
@@ -0,0 +1,257 @@
+#pragma once
+
+#ifndef SCO_HEADER_ONLY
+# include <sco/numa.hpp>
+#endif
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+# include <pthread.h>
+# include <sched.h>
+#endif
+
+namespace sco {
+namespace detail {
+
+// Parse a cpulist like "0-3,8-11".
+SCO_INLINE std::vector<int> parse_cpulist(const std::string& s) {
+    std::vector<int> ret;
+    std::size_t pos = 0;
+    while (pos < s.size()) {
+        auto end = s.find(',', pos);
+        if (end == std::string::npos) {
+            end = s.size();
+        }
+        auto item = s.substr(pos, end - pos);
+        pos = end + 1;
+
+        auto dash = item.find('-');
+        try {
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                ret.push_back(cpu);
+            }
+        } catch (const std::exception&) { // NOLINT(bugprone-empty-catch)
+            // skip the blank line end.
+        }
+    }
+    return ret;
+}
+
+SCO_INLINE bool cpu_allowed(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return true;
+    }
+    return cpu < CPU_SETSIZE && CPU_ISSET(cpu, &set);
+#else
+    return true;
+#endif
+}
+
+SCO_INLINE void pin_this_thread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // keep running unpinned if the CPU is not available to the process.
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+} // namespace detail
+
+SCO_INLINE std::vector<numa_node> numa_topology() {
+    namespace fs = std::filesystem;
+
+    std::vector<numa_node> ret;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator("/sys/devices/system/node", ec)) {
+        auto name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+            !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+
+        std::string list;
+        std::ifstream(entry.path() / "cpulist") >> list;
+
+        numa_node node{std::stoul(name.substr(4)), {}};
+        for (int cpu : detail::parse_cpulist(list)) {
+            if (detail::cpu_allowed(cpu)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        // the nodes with memory only have no workers.
+        if (!node.cpus.empty()) {
+            ret.push_back(std::move(node));
+        }
+    }
+    std::sort(ret.begin(), ret.end(), [](const auto& a, const auto& b) { return a.id < b.id; });
+
+    if (ret.empty()) {
+        numa_node node;
+        auto n = std::max(1U, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < n; ++cpu) {
+            node.cpus.push_back(static_cast<int>(cpu));
+        }
+        ret.push_back(std::move(node));
+    }
+    return ret;
+}
+
+SCO_INLINE void numa_pool::node_executor::post(detail::task* t) {
+    t->next_ = nullptr;
+    bool busy{};
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (tail_) {
+            tail_->next_ = t;
+        } else {
+            head_ = t;
+        }
+        tail_ = t;
+        size_.fetch_add(1, std::memory_order_release);
+        busy = idle_.load(std::memory_order_relaxed) == 0;
+    }
+    cv_.notify_one();
+
+    if (busy) {
+        owner_->wake_thief(*this);
+    }
+}
+
+// Lock held.
+SCO_INLINE detail::task* numa_pool::node_executor::try_pop() {
+    auto* t = head_;
+    if (t) {
+        head_ = t->next_;
+        if (!head_) {
+            tail_ = nullptr;
+        }
+        size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return t;
+}
+
+SCO_INLINE void numa_pool::node_executor::worker(int cpu) {
+    detail::pin_this_thread(cpu);
+    current_scope scope(this);
+
+    for (;;) {
+        detail::task* t{};
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            idle_.fetch_add(1, std::memory_order_relaxed);
+            cv_.wait(lock, [this] {
+                return head_ || owner_->stopped_.load(std::memory_order_acquire) || owner_->stealable(*this);
+            });
+            idle_.fetch_sub(1, std::memory_order_relaxed);
+
+            t = try_pop();
+            if (!t && owner_->stopped_.load(std::memory_order_acquire) && !owner_->stealable(*this)) {
+                return;
+            }
+        }
+
+        if (!t) {
+            t = owner_->steal(*this);
+            if (!t) {
+                continue;
+            }
+        }
+
+        try {
+            t->run_(t);
+        } catch (...) { // NOLINT(bugprone-empty-catch)
+            // the exception of a root coroutine finished here has no caller to go to.
+        }
+    }
+}
+
+SCO_INLINE numa_pool::numa_pool(bool steal): numa_pool(numa_topology(), steal) {}
+
+SCO_INLINE numa_pool::numa_pool(std::vector<numa_node> topology, bool steal):
+    nodes_(new node_executor[std::max<std::size_t>(topology.size(), 1)]),
+    size_(std::max<std::size_t>(topology.size(), 1)), steal_(steal) {
+    for (std::size_t i = 0; i < topology.size(); ++i) {
+        nodes_[i].owner_ = this;
+        nodes_[i].node_ = std::move(topology[i]);
+    }
+    if (topology.empty()) {
+        nodes_[0].owner_ = this;
+        nodes_[0].node_.cpus.push_back(0);
+    }
+
+    for (std::size_t i = 0; i < size_; ++i) {
+        for (int cpu : nodes_[i].node_.cpus) {
+            threads_.emplace_back([n = &nodes_[i], cpu] { n->worker(cpu); });
+        }
+    }
+}
+
+SCO_INLINE numa_pool::~numa_pool() {
+    stopped_.store(true, std::memory_order_release);
+    for (std::size_t i = 0; i < size_; ++i) {
+        { std::lock_guard<std::mutex> lock(nodes_[i].mu_); }
+        nodes_[i].cv_.notify_all();
+    }
+    for (auto& t : threads_) {
+        t.join();
+    }
+}
+
+// Another node has queued tasks and no idle worker.
+SCO_INLINE bool numa_pool::stealable(const node_executor& self) const {
+    if (!steal_) {
+        return false;
+    }
+    for (std::size_t i = 0; i < size_; ++i) {
+        const auto& n = nodes_[i];
+        if (&n != &self && n.size_.load(std::memory_order_acquire) != 0 && n.idle_.load(std::memory_order_relaxed) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SCO_INLINE detail::task* numa_pool::steal(const node_executor& self) {
+    for (std::size_t i = 0; i < size_; ++i) {
+        auto& n = nodes_[i];
+        if (&n == &self || n.size_.load(std::memory_order_acquire) == 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(n.mu_);
+        if (auto* t = n.try_pop()) {
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+// Wake an idle worker of another node to take the task of a busy node.
+SCO_INLINE void numa_pool::wake_thief(const node_executor& busy) {
+    if (!steal_) {
+        return;
+    }
+    for (std::size_t i = 0; i < size_; ++i) {
+        auto& n = nodes_[i];
+        if (&n != &busy && n.idle_.load(std::memory_order_relaxed) != 0) {
+            // the lock orders the wake after the worker has started waiting.
+            { std::lock_guard<std::mutex> lock(n.mu_); }
+            n.cv_.notify_one();
+            return;
+        }
+    }
+}
+
+} // namespace sco
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <sco/executor.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sco {
+
+// A NUMA node and the CPUs that belong to it.
+struct numa_node {
+    std::size_t id{};
+    std::vector<int> cpus;
+};
+
+// Read the NUMA topology from /sys/devices/system/node,
+// a single node holding all the CPUs if it is not available.
+std::vector<numa_node> numa_topology();
+
+// A pool with one worker thread pinned to each CPU, grouped by NUMA node.
+// A root started on a node passes it to its children, so their continuations
+// and the frames they allocate stay on the memory of that node.
+// An idle worker only takes tasks of another node when stealing is enabled
+// and all the workers of that node are busy.
+// ```c++
+// sco::numa_pool pool;
+// handle(conn).start_root_in_this_thread(pool.node(conn.id % pool.nodes()));
+// ```
+class numa_pool {
+public:
+    class node_executor: public executor {
+    private:
+        numa_pool* owner_{};
+        numa_node node_;
+
+        std::mutex mu_;
+        std::condition_variable cv_;
+        detail::task* head_{};
+        detail::task* tail_{};
+        std::atomic_size_t size_{};
+        std::atomic_size_t idle_{};
+
+        detail::task* try_pop();
+        void worker(int cpu);
+
+        friend numa_pool;
+
+    public:
+        void post(detail::task* t) override;
+
+        const numa_node& topology() const noexcept { return node_; }
+    };
+
+private:
+    std::unique_ptr<node_executor[]> nodes_;
+    std::size_t size_{};
+    bool steal_;
+    std::atomic_bool stopped_{};
+    std::vector<std::thread> threads_;
+
+public:
+    explicit numa_pool(bool steal = true);
+    numa_pool(std::vector<numa_node> topology, bool steal = true);
+
+    // The pending tasks are run before the threads exit.
+    ~numa_pool();
+
+    numa_pool(const numa_pool&) = delete;
+    numa_pool& operator=(const numa_pool&) = delete;
+    numa_pool(numa_pool&&) = delete;
+    numa_pool& operator=(numa_pool&&) = delete;
+
+    // The executor of the n-th node.
+    node_executor& node(std::size_t n) noexcept { return nodes_[n % size_]; }
+
+    std::size_t nodes() const noexcept { return size_; }
+
+    std::size_t size() const noexcept { return threads_.size(); }
+
+private:
+    bool stealable(const node_executor& self) const;
+    detail::task* steal(const node_executor& self);
+    void wake_thief(const node_executor& busy);
+};
+
+} // namespace sco
+
+#ifdef SCO_HEADER_ONLY
+# include <sco/numa-inl.hpp>
+#endif
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <sco/callback.hpp>
+#include <sco/executor.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <ranges>
+#include <vector>
+
+namespace sco {
+namespace detail {
+
+// The Future that splits a random access range into chunks run on an executor,
+// the awaiting coroutine is resumed when the last chunk is done.
+template<typename Iter, typename Body, typename Partial>
+class parallel_future: protected future_base {
+private:
+    struct chunk: public task {
+        parallel_future* self;
+        std::size_t first, last;
+        std::exception_ptr exception;
+        Partial partial;
+    };
+
+    executor& ex_;
+    Iter begin_;
+    Body body_;
+    std::vector<chunk> chunks_;
+    callback_base cb_;
+
+private:
+    int pending_count() const noexcept { return static_cast<int>(chunks_.size()); }
+
+    void set_sync_object(const sync_object& sync) {
+        cb_.promise = sync;
+        cb_.exception = &exception_;
+    }
+
+    void resume() {
+        for (auto& c : chunks_) {
+            c.self = this;
+            c.run_ = [](task* t) {
+                auto& c = *static_cast<chunk*>(t);
+                try {
+                    c.self->body_(c.self->begin_ + c.first, c.self->begin_ + c.last, c.partial);
+                } catch (...) {
+                    c.exception = std::current_exception();
+                }
+                c.self->cb_.resume();
+            };
+            ex_.post(&c);
+        }
+    }
+
+    std::exception_ptr return_exception() {
+        for (auto& c : chunks_) {
+            if (c.exception) {
+                return c.exception;
+            }
+        }
+        return {};
+    }
+
+protected:
+    std::vector<chunk>& chunks() { return chunks_; }
+
+    friend future_caller;
+
+public:
+    parallel_future(executor& ex, Iter begin, std::size_t n, std::size_t grain, Body&& body, const Partial& init)
+        : ex_(ex), begin_(std::move(begin)), body_(std::move(body)) {
+        if (grain == 0) {
+            grain = 1;
+        }
+        chunks_.reserve((n + grain - 1) / grain);
+        for (std::size_t first = 0; first < n; first += grain) {
+            chunks_.push_back(chunk{{}, this, first, std::min(n, first + grain), {}, init});
+        }
+    }
+};
+
+struct parallel_none {};
+
+template<typename Iter, typename Body>
+class parallel_for_future: public parallel_future<Iter, Body, parallel_none> {
+private:
+    constexpr void return_value() const noexcept {}
+
+    friend future_caller;
+
+public:
+    using parallel_future<Iter, Body, parallel_none>::parallel_future;
+};
+
+template<typename Iter, typename Body, typename T, typename Reduce>
+class parallel_reduce_future: public parallel_future<Iter, Body, T> {
+private:
+    T identity_;
+    Reduce reduce_;
+
+    T return_value() {
+        T ret = identity_;
+        for (auto& c : this->chunks()) {
+            ret = reduce_(std::move(ret), std::move(c.partial));
+        }
+        return ret;
+    }
+
+    friend future_caller;
+
+public:
+    parallel_reduce_future(executor& ex, Iter begin, std::size_t n, std::size_t grain, Body&& body,
+        T identity, Reduce reduce)
+        : parallel_future<Iter, Body, T>(ex, std::move(begin), n, grain, std::move(body), identity),
+          identity_(std::move(identity)), reduce_(std::move(reduce)) {}
+};
+
+} // namespace detail
+
+// Call fn on every element of a random access range, in chunks of grain elements
+// run on the executor. co_await it, the coroutine resumes when all chunks are done,
+// the first exception thrown by fn is rethrown.
+// fn is called concurrently from the executor threads.
+template<std::ranges::random_access_range Range, typename Fn>
+auto parallel_for(executor& ex, Range&& range, std::size_t grain, Fn fn) {
+    auto body = [fn = std::move(fn)](auto first, auto last, detail::parallel_none&) {
+        for (; first != last; ++first) {
+            fn(*first);
+        }
+    };
+    using Iter = std::ranges::iterator_t<Range>;
+    return detail::parallel_for_future<Iter, decltype(body)>(ex, std::ranges::begin(range),
+        static_cast<std::size_t>(std::ranges::distance(range)), grain, std::move(body), {});
+}
+
+// Fold every chunk with fn(T acc, element) starting from identity on the executor,
+// then combine the partial results in order with reduce(T, T).
+template<std::ranges::random_access_range Range, typename T, typename Fn, typename Reduce>
+auto parallel_reduce(executor& ex, Range&& range, std::size_t grain, T identity, Fn fn, Reduce reduce) {
+    auto body = [fn = std::move(fn)](auto first, auto last, T& acc) {
+        for (; first != last; ++first) {
+            acc = fn(std::move(acc), *first);
+        }
+    };
+    using Iter = std::ranges::iterator_t<Range>;
+    return detail::parallel_reduce_future<Iter, decltype(body), T, Reduce>(ex, std::ranges::begin(range),
+        static_cast<std::size_t>(std::ranges::distance(range)), grain, std::move(body),
+        std::move(identity), std::move(reduce));
+}
+
+} // namespace sco
@@ -0,0 +1,423 @@
+#pragma once
+
+#include <sco/async.hpp>
+#include <sco/callback.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace sco {
+
+// An async pool of resources, e.g. connections, `co_await pool.acquire()` returns a lease
+// that gives the resource back when destroyed.
+// The resources are created by a coroutine, checked by an optional coroutine before they are lent,
+// and evicted when idle for longer than idle_timeout, down to min_size.
+// The eviction runs on acquire and release, a pool without calls keeps its resources.
+// The pool is split into shards picked by thread, each with its own lock and a share of max_size
+// (at most max_size shards), a shard borrows the idle resources or free slots of the others before waiting.
+// The waiters of all the shards share one queue, taken only when somebody waits.
+// ```c++
+// sco::pool<redis_conn> redis([] { return connect_async(url); }, {.max_size = 8, .shards = 4});
+// auto conn = co_await redis.acquire();
+// co_await conn->get(key);
+// ```
+template<typename T>
+class pool {
+public:
+    struct options {
+        std::size_t min_size = 0;
+        std::size_t max_size = 16;
+        std::chrono::milliseconds idle_timeout{std::chrono::minutes(1)};
+        std::size_t shards = 1;
+    };
+
+    using factory = std::function<async<T>()>;
+    using checker = std::function<async<bool>(T&)>;
+
+private:
+    struct item {
+        T value;
+        std::chrono::steady_clock::time_point idle_since;
+        item* next{};
+    };
+
+    struct shard;
+
+    struct waiter {
+        detail::callback_base cb;
+        // the item handed over, or null with a slot reserved to create one,
+        // and the shard it is accounted to.
+        item* handed{};
+        shard* from{};
+        waiter* next{};
+    };
+
+    struct shard {
+        std::mutex mu;
+        item* idle{};
+        std::size_t idle_count{};
+        std::size_t size{};
+        std::size_t max_size{};
+    };
+
+public:
+    // Lent by acquire(), gives the resource back when destroyed.
+    class lease {
+    private:
+        pool* pool_{};
+        shard* shard_{};
+        item* item_{};
+
+    public:
+        lease() = default;
+        lease(pool* p, shard* s, item* it): pool_(p), shard_(s), item_(it) {}
+        lease(lease&& other) noexcept: pool_(other.pool_), shard_(other.shard_), item_(std::exchange(other.item_, nullptr)) {}
+        lease& operator=(lease&& other) noexcept {
+            if (this != &other) {
+                release();
+                pool_ = other.pool_;
+                shard_ = other.shard_;
+                item_ = std::exchange(other.item_, nullptr);
+            }
+            return *this;
+        }
+        lease(const lease&) = delete;
+        lease& operator=(const lease&) = delete;
+
+        ~lease() { release(); }
+
+        T& operator*() const noexcept { return item_->value; }
+        T* operator->() const noexcept { return &item_->value; }
+        explicit operator bool() const noexcept { return item_ != nullptr; }
+
+        // Give the resource back to the pool.
+        void release() {
+            if (auto* it = std::exchange(item_, nullptr)) {
+                pool_->give_back(*shard_, it);
+            }
+        }
+
+        // Destroy the resource, e.g. a broken connection.
+        void discard() {
+            if (auto* it = std::exchange(item_, nullptr)) {
+                delete it;
+                pool_->free_slot(*shard_);
+            }
+        }
+    };
+
+private:
+    factory create_;
+    checker check_;
+    options opts_;
+    std::unique_ptr<shard[]> shards_;
+    // lock order: wait_mu_, then one shard at a time.
+    std::mutex wait_mu_;
+    waiter* head_{};
+    waiter* tail_{};
+    std::atomic_size_t waiting_{};
+
+public:
+    explicit pool(factory create, options opts = {}, checker check = {}):
+        create_(std::move(create)), check_(std::move(check)), opts_(opts),
+        shards_(new shard[shard_count(opts)]) {
+        opts_.shards = shard_count(opts);
+        for (std::size_t i = 0; i < opts_.shards; ++i) {
+            // split max_size, the shares sum to max_size.
+            shards_[i].max_size = (opts_.max_size + opts_.shards - 1 - i) / opts_.shards;
+        }
+    }
+
+    // The leases must have been released.
+    ~pool() {
+        for (std::size_t i = 0; i < opts_.shards; ++i) {
+            for (auto* it = shards_[i].idle; it;) {
+                delete std::exchange(it, it->next);
+            }
+        }
+    }
+
+    pool(const pool&) = delete;
+    pool& operator=(const pool&) = delete;
+
+    // Create min_size resources.
+    async<> warm_up() {
+        for (std::size_t n = size(); n < opts_.min_size; ++n) {
+            auto& s = local_shard();
+            auto* from = &s;
+            if (!reserve(s) && !reserve_other(s, from)) {
+                break;
+            }
+            lease l(this, from, co_await create_item(*from));
+        }
+    }
+
+    // Wait for a resource.
+    async<lease> acquire() {
+        auto& s = local_shard();
+        for (;;) {
+            item* it{};
+            auto* from = &s;
+            bool reserved{};
+            {
+                std::lock_guard<std::mutex> lock(s.mu);
+                evict(s);
+                it = pop_idle(s);
+                if (!it && s.size < s.max_size) {
+                    ++s.size;
+                    reserved = true;
+                }
+            }
+            if (!it && !reserved) {
+                it = borrow(s, from);
+            }
+            if (!it && !reserved) {
+                // a free slot in another shard.
+                reserved = reserve_other(s, from);
+            }
+            if (!it && !reserved) {
+                // wait for a release or a free slot in any shard.
+                std::tie(it, from) = co_await wait();
+                reserved = !it;
+            }
+
+            if (reserved) {
+                co_return lease(this, from, co_await create_item(*from));
+            }
+            bool healthy = true;
+            if (check_) {
+                try {
+                    healthy = co_await check_(it->value);
+                } catch (...) {
+                    healthy = false;
+                }
+            }
+            if (!healthy) {
+                // destroy it and try again.
+                delete it;
+                free_slot(*from);
+                continue;
+            }
+            co_return lease(this, from, it);
+        }
+    }
+
+    // The number of resources, idle or lent.
+    std::size_t size() {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < opts_.shards; ++i) {
+            std::lock_guard<std::mutex> lock(shards_[i].mu);
+            n += shards_[i].size;
+        }
+        return n;
+    }
+
+private:
+    // At most one shard per slot, so every shard can hold a resource.
+    static std::size_t shard_count(const options& opts) {
+        return std::clamp<std::size_t>(opts.shards, 1, std::max<std::size_t>(opts.max_size, 1));
+    }
+
+    shard& local_shard() {
+        if (opts_.shards == 1) {
+            return shards_[0];
+        }
+        static thread_local std::size_t hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+        return shards_[hash % opts_.shards];
+    }
+
+    bool reserve(shard& s) {
+        std::lock_guard<std::mutex> lock(s.mu);
+        if (s.size >= s.max_size) {
+            return false;
+        }
+        ++s.size;
+        return true;
+    }
+
+    async<item*> create_item(shard& s) {
+        try {
+            co_return new item{co_await create_(), {}, nullptr};
+        } catch (...) {
+            free_slot(s);
+            throw;
+        }
+    }
+
+    // Lock held.
+    static item* pop_idle(shard& s) {
+        auto* it = s.idle;
+        if (it) {
+            s.idle = it->next;
+            --s.idle_count;
+        }
+        return it;
+    }
+
+    // Lock held, the idle list is ordered from the most recently used.
+    void evict(shard& s) {
+        auto now = std::chrono::steady_clock::now();
+        auto min = (opts_.min_size + opts_.shards - 1) / opts_.shards;
+        auto** link = &s.idle;
+        while (*link) {
+            auto* it = *link;
+            if (s.size > min && now - it->idle_since > opts_.idle_timeout) {
+                *link = it->next;
+                --s.idle_count;
+                --s.size;
+                delete it;
+            } else {
+                link = &it->next;
+            }
+        }
+    }
+
+    item* borrow(shard& self, shard*& from) {
+        for (std::size_t i = 0; i < opts_.shards; ++i) {
+            auto& s = shards_[i];
+            if (&s == &self) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(s.mu);
+            if (auto* it = pop_idle(s)) {
+                from = &s;
+                return it;
+            }
+        }
+        return nullptr;
+    }
+
+    bool reserve_other(shard& self, shard*& from) {
+        for (std::size_t i = 0; i < opts_.shards; ++i) {
+            auto& s = shards_[i];
+            if (&s != &self && reserve(s)) {
+                from = &s;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Lock of wait_mu_ held, an idle item or a free slot in any shard.
+    bool take_any(item*& it, shard*& from) {
+        for (std::size_t i = 0; i < opts_.shards; ++i) {
+            auto& s = shards_[i];
+            std::lock_guard<std::mutex> lock(s.mu);
+            it = pop_idle(s);
+            if (it || s.size < s.max_size) {
+                if (!it) {
+                    ++s.size;
+                }
+                from = &s;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto wait() {
+        class future: protected detail::future_base {
+        private:
+            pool& p_;
+            waiter w_;
+
+        private:
+            void set_sync_object(const detail::sync_object& sync) {
+                w_.cb.promise = sync;
+                w_.cb.exception = &exception_;
+            }
+
+            void resume() {
+                std::unique_lock<std::mutex> lock(p_.wait_mu_);
+                // counted before the shards are checked, a release after the check sees the waiter.
+                p_.waiting_.fetch_add(1);
+                if (!p_.take_any(w_.handed, w_.from)) {
+                    if (p_.tail_) {
+                        p_.tail_->next = &w_;
+                    } else {
+                        p_.head_ = &w_;
+                    }
+                    p_.tail_ = &w_;
+                    return;
+                }
+                p_.waiting_.fetch_sub(1);
+                lock.unlock();
+                w_.cb.resume();
+            }
+
+            std::pair<item*, shard*> return_value() { return {w_.handed, w_.from}; }
+
+            friend detail::future_caller;
+
+        public:
+            explicit future(pool& p): p_(p) {}
+        };
+
+        return future(*this);
+    }
+
+    // Hand an idle item or a free slot of s to the first waiter.
+    void wake(shard& s) {
+        std::unique_lock<std::mutex> lock(wait_mu_);
+        auto* w = head_;
+        if (!w) {
+            return;
+        }
+        item* it{};
+        {
+            std::lock_guard<std::mutex> shard_lock(s.mu);
+            it = pop_idle(s);
+            if (!it) {
+                if (s.size >= s.max_size) {
+                    // taken by another call in between.
+                    return;
+                }
+                ++s.size;
+            }
+        }
+        head_ = w->next;
+        if (!head_) {
+            tail_ = nullptr;
+        }
+        waiting_.fetch_sub(1);
+        lock.unlock();
+        w->handed = it;
+        w->from = &s;
+        w->cb.resume();
+    }
+
+    void give_back(shard& s, item* it) {
+        {
+            std::lock_guard<std::mutex> lock(s.mu);
+            it->idle_since = std::chrono::steady_clock::now();
+            it->next = s.idle;
+            s.idle = it;
+            ++s.idle_count;
+            evict(s);
+        }
+        if (waiting_.load() > 0) {
+            wake(s);
+        }
+    }
+
+    void free_slot(shard& s) {
+        {
+            std::lock_guard<std::mutex> lock(s.mu);
+            --s.size;
+        }
+        if (waiting_.load() > 0) {
+            // the slot goes to a waiter, which creates a resource.
+            wake(s);
+        }
+    }
+};
+
+} // namespace sco
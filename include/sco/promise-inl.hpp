@@ -18,38 +18,120 @@ SCO_INLINE COSTD::coroutine_handle<> root_result::root_handle() {
     return COSTD::coroutine_handle<>::from_address(root_handle_address);
 }
 
-SCO_INLINE sync_object make_sync_object_(int pending, promise_type_base* promise, const COSTD::coroutine_handle<>& h) {
-    return std::make_shared<promise_shared>(pending, promise, h.address());
+SCO_INLINE root_result::opt*& this_thread_root_result() {
+    static thread_local root_result::opt* ret{};
+    return ret;
 }
 
-SCO_INLINE COSTD::coroutine_handle<> promise_type_base::final_awaiter::await_suspend_(const COSTD::coroutine_handle<>& h, promise_type_base& promise) {
-    auto& parent = promise.sync_;
+SCO_INLINE resume_budget_state& this_thread_resume_budget() {
+    static thread_local resume_budget_state ret;
+    return ret;
+}
+
+SCO_INLINE root_result_scope::root_result_scope(): prev(this_thread_root_result()) {
+    this_thread_root_result() = &res;
+    if (!prev) {
+        // a new burst.
+        auto& st = this_thread_resume_budget();
+        st.used = 0;
+        if (st.budget.max_time.count() > 0) {
+            st.begin = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+SCO_INLINE root_result_scope::~root_result_scope() {
+    this_thread_root_result() = prev;
+}
+
+SCO_INLINE bool post_if_over_budget(promise_shared& sync) {
+    auto& st = this_thread_resume_budget();
+    bool spent = st.budget.max_resumes > 0 && ++st.used > st.budget.max_resumes;
+    if (!spent && st.budget.max_time.count() > 0 && this_thread_root_result()) {
+        spent = std::chrono::steady_clock::now() - st.begin > st.budget.max_time;
+    }
+    if (!spent) {
+        return false;
+    }
+
+    auto* ex = sync.promise && sync.promise->executor_ ? sync.promise->executor_ : executor::current();
+    if (!ex) {
+        // nowhere to yield to.
+        return false;
+    }
+    sync.run_ = [](task* t) {
+        resume_sync_in_this_thread(*static_cast<promise_shared*>(t));
+    };
+    ex->post(&sync);
+    return true;
+}
+
+SCO_INLINE void resume_sync_in_this_thread(promise_shared& sync) {
+    root_result_scope scope;
+    auto& res = scope.res;
+
+    sync.handle().resume();
+
+    if (res) {
+        // destroy the root coroutine.
+        res->root_handle().destroy();
+    }
+
+    if (res && res->exception) {
+        std::rethrow_exception(res->exception);
+    }
+}
+
+SCO_INLINE void init_sync_object_(promise_shared& sync, int pending, promise_type_base* promise, const COSTD::coroutine_handle<>& h) {
+    sync.await_pending.store(pending, std::memory_order_relaxed);
+    sync.promise = promise;
+    sync.handle_address = h.address();
+}
+
+SCO_INLINE COSTD::coroutine_handle<> promise_type_base::final_awaiter::await_suspend_(const COSTD::coroutine_handle<>& h, promise_type_base& promise,
+    const std::exception_ptr& ex) {
+    auto* parent = promise.sync_;
     if (!parent) {
         // If the current coroutine is the root coroutine,
-        // save additional results to the thread stack.
-        *promise.root_ = root_result{
-            promise.exception_,
-            h.address(),
-        };
+        // save additional results to the resume running in this thread.
+        if (auto* res = this_thread_root_result()) {
+            *res = root_result{
+                ex,
+                h.address(),
+            };
+        } else {
+            // resumed by a foreign awaitable outside of any resume, no one is waiting for the result.
+            h.destroy();
+        }
         return COSTD::noop_coroutine();
     }
 
     if (parent->release_and_check_await_done()) {
-        // Propagating up.
-        if (promise.root_ && parent->promise) {
-            parent->promise->root_ = promise.root_;
-        }
         return parent->handle();
     }
     return COSTD::noop_coroutine();
 }
 
-SCO_INLINE void promise_type_base::unhandled_exception() {
-    exception_ = std::current_exception();
-}
-
 SCO_INLINE void promise_type_base::set_sync_object_from_future(const sync_object& sync) {
     sync_ = sync;
+    if (sync->promise) {
+        if (sync->promise->executor_) {
+            executor_ = sync->promise->executor_;
+        }
+        context_ = sync->promise->context_;
+    }
 }
 
 } // namespace sco::detail
+
+namespace sco {
+
+SCO_INLINE void set_resume_budget(const resume_budget& budget) {
+    detail::this_thread_resume_budget().budget = budget;
+}
+
+SCO_INLINE resume_budget get_resume_budget() {
+    return detail::this_thread_resume_budget().budget;
+}
+
+} // namespace sco
@@ -2,21 +2,56 @@
 
 #include <sco/common.h>
 #include <sco/awaiter.hpp>
+#include <sco/executor.hpp>
+#include <sco/expected.hpp>
 
 #include <memory>
 #include <atomic>
+#include <chrono>
 #include <optional>
+#include <variant>
+
+namespace sco {
+
+// Exception policies of the coroutine promise.
+// The unhandled exceptions are captured in the frame and rethrown by co_await.
+struct throwing {};
+// No exception storage in the frame, an unhandled exception calls std::terminate.
+struct nothrow {};
+
+// forward declaration
+class context_base;
+
+// The budget of the synchronous completions a thread resumes inline in one burst,
+// a burst starts when the thread resumes a coroutine from outside of any resume, e.g. from its event loop.
+// Once the budget is spent, the continuations are posted to the executor of the coroutine,
+// or to the executor running in this thread, so one request cannot hold the thread for long.
+// 0 disables a limit, both are disabled by default: with a budget a callback may return
+// before the coroutine has resumed, so what it passed by reference must outlive the callback.
+struct resume_budget {
+    std::size_t max_resumes = 0;
+    std::chrono::microseconds max_time{0};
+};
+
+// Set the budget of the current thread.
+void set_resume_budget(const resume_budget& budget);
+
+resume_budget get_resume_budget();
+
+} // namespace sco
 
 namespace sco::detail {
 
 // forward declaration
 struct promise_type_base;
+struct context_access;
 
 // Using reference counting ensures that the current thread
 // can operate on the coroutine.
-struct promise_shared {
-    using ptr = std::shared_ptr<promise_shared>;
-
+// It lives in the awaiter, which is kept in the frame of the awaiting coroutine
+// until it is resumed, so no allocation is needed.
+// It is also the task posted to the executor of the coroutine.
+struct promise_shared: public task {
     // When the counter reaches 0, it means that the current thread
     // is able to operate on the coroutine, such as resuming it.
     std::atomic_int await_pending;
@@ -28,6 +63,7 @@ struct promise_shared {
     void *handle_address{};
     COSTD::coroutine_handle<> handle();
 
+    constexpr promise_shared() = default;
     constexpr promise_shared(int pending, promise_type_base* promise, void *h)
         : await_pending(pending), promise(promise), handle_address(h) {}
 };
@@ -44,17 +80,50 @@ struct root_result {
     COSTD::coroutine_handle<> root_handle();
 };
 
-// The synchronization object passed between Awaiter and Future
-// may have additional supplements in the future.
-using sync_object = promise_shared::ptr;
-sync_object make_sync_object_(int pending, promise_type_base* promise, const COSTD::coroutine_handle<>& h);
+// The root result of the resume running in this thread,
+// the root coroutine that finishes during this resume stores its result here.
+root_result::opt*& this_thread_root_result();
+
+// Installs the root result of a resume in this thread,
+// a nested resume restores the outer one when it returns.
+struct root_result_scope {
+    root_result::opt res;
+    root_result::opt* prev;
+
+    root_result_scope();
+    ~root_result_scope();
+    root_result_scope(const root_result_scope&) = delete;
+    root_result_scope& operator=(const root_result_scope&) = delete;
+};
+
+// The resume budget of a thread and the inline resumes of its current burst.
+struct resume_budget_state {
+    resume_budget budget;
+    std::size_t used{};
+    std::chrono::steady_clock::time_point begin;
+};
+
+resume_budget_state& this_thread_resume_budget();
+
+// Count a synchronous completion against the budget of this thread,
+// returns true if the continuation has been posted to an executor instead of resumed inline.
+bool post_if_over_budget(promise_shared& sync);
+
+// Resume the coroutine of the sync object with a root result scope,
+// destroys the root coroutine that finishes and rethrows its exception.
+void resume_sync_in_this_thread(promise_shared& sync);
+
+// The synchronization object passed between Awaiter and Future,
+// it is owned by the Awaiter.
+using sync_object = promise_shared*;
+void init_sync_object_(promise_shared& sync, int pending, promise_type_base* promise, const COSTD::coroutine_handle<>& h);
 
 template<typename T>
-auto make_sync_object(int pending, T* promise, const COSTD::coroutine_handle<>& h) {
+void init_sync_object(promise_shared& sync, int pending, T* promise, const COSTD::coroutine_handle<>& h) {
     if constexpr (std::is_base_of_v<promise_type_base, T>) {
-        return make_sync_object_(pending, promise, h);
+        init_sync_object_(sync, pending, promise, h);
     } else {
-        return make_sync_object_(pending, nullptr, h);
+        init_sync_object_(sync, pending, nullptr, h);
     }
 }
 
@@ -70,21 +139,18 @@ struct promise_type_base {
     // coroutines should start executing when co_awaited or resumed explicitly."
     constexpr COSTD::suspend_always initial_suspend() const noexcept { return {}; }
 
-    // Pointer points to thread stack, allowing thread to obtain root coroutine finish status.
-    root_result::opt* root_{};
-    constexpr void set_root_result_from_thread(root_result::opt& res) { root_ = &res; }
-
     // The awaiter returned by final_suspend.
     struct final_awaiter {
         constexpr bool await_ready() const noexcept { return false; }
 
         // Returning to the parent coroutine handle can automatically resume the parent coroutine.
-        COSTD::coroutine_handle<> await_suspend_(const COSTD::coroutine_handle<>& h, promise_type_base& promise);
+        COSTD::coroutine_handle<> await_suspend_(const COSTD::coroutine_handle<>& h, promise_type_base& promise,
+            const std::exception_ptr& ex);
 
         // By instantiating the Promise class with a template, the promise function can be called.
         template<typename Child>
         COSTD::coroutine_handle<> await_suspend(COSTD::coroutine_handle<Child> h) noexcept {
-            return await_suspend_(h, h.promise());
+            return await_suspend_(h, h.promise(), h.promise().return_exception());
         }
 
         // The final_suspend awaiter ignores the return value.
@@ -92,30 +158,37 @@ struct promise_type_base {
     };
     constexpr final_awaiter final_suspend() const noexcept { return {}; }
 
-    std::exception_ptr exception_;
-    // Capturing unhandled exceptions in the current coroutine.
-    void unhandled_exception();
-
     // Save the synchronization object passed by the Awaiter.
-    sync_object sync_;
+    sync_object sync_{};
     void set_sync_object_from_future(const sync_object& sync);
 
+    // The completions from other threads are handed over to this executor
+    // instead of resuming in the callback thread, inherited from the parent.
+    executor* executor_{};
+
+    // The context bound by this coroutine or inherited from the parent, see sco::context.
+    context_base* context_{};
+
     // This awaiter connects co_await with the Future.
     template<typename Future>
     struct future_awaiter {
         using Ret = typename future_traits<Future>::return_type;
         Future&& fut;
+        promise_shared sync{};
 
         constexpr bool await_ready() const noexcept { return false; }
 
         template<typename Child>
         bool await_suspend(COSTD::coroutine_handle<Child> h) {
-            auto sync = make_sync_object(future_caller::pending_count(fut) + 1, &h.promise(), h);
-            future_caller::set_sync_object(fut, sync);
+            init_sync_object(sync, future_caller::pending_count(fut) + 1, &h.promise(), h);
+            future_caller::set_sync_object(fut, &sync);
             future_caller::resume(fut);
 
-            // If false is returned, then resume the coroutine.
-            return !sync->release_and_check_await_done();
+            if (!sync.release_and_check_await_done()) {
+                return true;
+            }
+            // completed synchronously, resume inline unless the budget of this thread is spent.
+            return post_if_over_budget(sync);
         }
 
         // return value via co_await.
@@ -141,37 +214,120 @@ struct promise_type_base {
     }
 };
 
-// Promise type use with coroutine_handle.
-template<typename Coro, typename Ret>
-struct promise_type: public promise_type_base {
-    using handle_type = COSTD::coroutine_handle<promise_type>;
+// The result storage selected by the return type and the exception policy,
+// the value and the exception share the same storage.
+template<typename Ret, typename Policy>
+struct promise_result;
 
-    // make the coroutine_handle from this promise.
-    auto get_return_object() {
-        return Coro(handle_type::from_promise(*this));
+template<typename Ret>
+struct promise_result<Ret, throwing> {
+    std::variant<std::monostate, Ret, std::exception_ptr> result_;
+
+    // return value via co_return.
+    template<typename T, typename = std::enable_if_t<std::is_convertible_v<T, Ret>>>
+    void return_value(T&& v) noexcept {
+        result_.template emplace<1>(std::forward<T>(v));
+    }
+
+    // Capturing unhandled exceptions in the current coroutine.
+    void unhandled_exception() { result_.template emplace<2>(std::current_exception()); }
+
+    std::exception_ptr return_exception() const {
+        const auto* ex = std::get_if<2>(&result_);
+        return ex ? *ex : std::exception_ptr{};
     }
+    Ret take_value() { return std::move(*std::get_if<1>(&result_)); }
+};
 
-    std::optional<Ret> value_;
+template<typename Ret>
+struct promise_result<Ret, nothrow> {
+    std::optional<Ret> result_;
 
-    // return value via co_return.
     template<typename T, typename = std::enable_if_t<std::is_convertible_v<T, Ret>>>
     void return_value(T&& v) noexcept {
-        value_ = std::forward<T>(v);
+        result_ = std::forward<T>(v);
     }
+
+    [[noreturn]] void unhandled_exception() const noexcept { std::terminate(); }
+
+    std::exception_ptr return_exception() const noexcept { return {}; }
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    Ret take_value() { return std::move(*result_); }
+};
+
+template<>
+struct promise_result<void, throwing> {
+    std::exception_ptr exception_;
+
+    constexpr void return_void() const noexcept {}
+
+    void unhandled_exception() { exception_ = std::current_exception(); }
+
+    std::exception_ptr return_exception() const { return exception_; }
 };
 
-// Specialization for void return type.
-template<typename Coro>
-struct promise_type<Coro, void>: public promise_type_base {
+template<>
+struct promise_result<void, nothrow> {
+    constexpr void return_void() const noexcept {}
+
+    [[noreturn]] void unhandled_exception() const noexcept { std::terminate(); }
+
+    std::exception_ptr return_exception() const noexcept { return {}; }
+};
+
+// This awaiter unwraps an expected in a coroutine that returns an expected,
+// an error short-circuits the coroutine without throwing.
+template<typename Exp>
+struct expected_awaiter {
+    Exp&& exp;
+
+    constexpr bool await_ready() const noexcept { return exp.has_value(); }
+
+    // Return the error like co_return, then finish as final_suspend does.
+    // The frame stays suspended here until it is destroyed.
+    template<typename Promise>
+    COSTD::coroutine_handle<> await_suspend(COSTD::coroutine_handle<Promise> h) {
+        using E = typename Promise::value_type::error_type;
+        h.promise().return_value(unexpected<E>(std::forward<Exp>(exp).error()));
+        return promise_type_base::final_awaiter{}.await_suspend(h);
+    }
+
+    decltype(auto) await_resume() {
+        using T = typename std::remove_cvref_t<Exp>::value_type;
+        if constexpr (std::is_void_v<T>) {
+            return;
+        } else if constexpr (std::is_lvalue_reference_v<Exp>) {
+            return static_cast<T&>(*exp);
+        } else {
+            return T(std::move(*exp));
+        }
+    }
+};
+
+// Promise type use with coroutine_handle.
+template<typename Coro, typename Ret, typename Policy = throwing>
+struct promise_type: public promise_type_base, public promise_result<Ret, Policy> {
     using handle_type = COSTD::coroutine_handle<promise_type>;
+    using value_type = Ret;
 
+    // make the coroutine_handle from this promise.
     auto get_return_object() {
         return Coro(handle_type::from_promise(*this));
     }
 
-    constexpr void return_void() const noexcept {}
+    template<typename Awaitable>
+    constexpr decltype(auto) await_transform(Awaitable&& aw) {
+        if constexpr (is_expected_v<Ret> && is_expected_v<Awaitable>) {
+            return expected_awaiter<Awaitable>{std::forward<Awaitable>(aw)};
+        } else {
+            return promise_type_base::await_transform(std::forward<Awaitable>(aw));
+        }
+    }
 };
 
+// The fields every frame carries: the sync object of the parent, the inherited executor and context.
+static_assert(sizeof(promise_type_base) == 3 * sizeof(void*), "promise_type_base layout changed");
+
 } // namespace sco::detail
 
 #ifdef SCO_HEADER_ONLY
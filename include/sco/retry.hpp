@@ -0,0 +1,279 @@
+#pragma once
+
+#include <sco/all.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sco {
+
+// Thrown when an attempt has not finished before its deadline.
+class timeout_error: public std::runtime_error {
+public:
+    timeout_error(): std::runtime_error("sco attempt timed out") {}
+};
+
+// The timer used by retry and hedge, e.g. a coroutine around the timer of the event loop.
+using sleep_function = std::function<async<>(std::chrono::milliseconds)>;
+
+// Caps the retries to a ratio of the calls, shared by all the calls to one backend,
+// so that retries cannot multiply the load of a backend that is already failing.
+class retry_budget {
+private:
+    static constexpr long scale = 1000;
+    std::atomic_long tokens_;
+    long deposit_;
+    long max_;
+
+public:
+    // ratio retries per call, and min_retries available at any time.
+    explicit retry_budget(double ratio = 0.1, long min_retries = 10):
+        tokens_(min_retries * scale), deposit_(static_cast<long>(ratio * scale)), max_(min_retries * scale) {}
+
+    // Called for every call.
+    void deposit() noexcept {
+        auto t = tokens_.load(std::memory_order_relaxed);
+        while (t < max_ && !tokens_.compare_exchange_weak(t, std::min(max_, t + deposit_), std::memory_order_relaxed)) {}
+    }
+
+    // Called before every retry, false if the budget is exhausted.
+    bool withdraw() noexcept {
+        auto t = tokens_.load(std::memory_order_relaxed);
+        while (t >= scale) {
+            if (tokens_.compare_exchange_weak(t, t - scale, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+struct retry_policy {
+    int max_attempts = 3;
+
+    // The backoff before the n-th retry is initial_backoff * multiplier^(n-1), at most max_backoff,
+    // minus a random part of up to jitter of it.
+    std::chrono::milliseconds initial_backoff{10};
+    std::chrono::milliseconds max_backoff{1000};
+    double multiplier = 2.0;
+    double jitter = 0.5;
+
+    // The deadline of each attempt, zero for none.
+    std::chrono::milliseconds attempt_timeout{0};
+
+    // Whether a failure is retried, all by default.
+    std::function<bool(const std::exception_ptr&)> retryable;
+
+    // Optional, shared by the calls to one backend.
+    retry_budget* budget = nullptr;
+
+    // Required by backoff and attempt_timeout.
+    sleep_function sleep;
+
+    std::chrono::milliseconds backoff(int retry) const {
+        double ms = static_cast<double>(initial_backoff.count());
+        for (int i = 1; i < retry && ms < static_cast<double>(max_backoff.count()); ++i) {
+            ms *= multiplier;
+        }
+        ms = std::min(ms, static_cast<double>(max_backoff.count()));
+
+        static thread_local std::minstd_rand rng{std::random_device{}()};
+        std::uniform_real_distribution<double> dist(1.0 - std::clamp(jitter, 0.0, 1.0), 1.0);
+        return std::chrono::milliseconds(static_cast<long>(ms * dist(rng)));
+    }
+};
+
+namespace detail {
+
+// The state shared by the legs of a race, the first leg to settle wins,
+// or if FirstSuccess, the first leg to succeed and the last failure if all fail.
+template<typename Ret, bool FirstSuccess>
+struct race_state {
+    callback_base cb;
+    std::atomic_int remaining;
+    std::atomic_bool resumed{};
+    fail_fast_slot<Ret> value;
+
+    explicit race_state(int n): remaining(n) {}
+
+    template<typename... V>
+    void win(V&&... v) {
+        if (!resumed.exchange(true, std::memory_order_acq_rel)) {
+            value.emplace(std::forward<V>(v)...);
+            cb.resume();
+        }
+    }
+
+    void lose(const std::exception_ptr& ex) {
+        bool last = remaining.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        if ((!FirstSuccess || last) && !resumed.exchange(true, std::memory_order_acq_rel)) {
+            *cb.exception = ex;
+            cb.resume();
+        }
+    }
+
+    executor* home() const {
+        return cb.promise->promise ? cb.promise->promise->executor_ : nullptr;
+    }
+};
+
+// The value is kept out of the try, win() resumes the awaiter and what it throws is not a failure of the leg.
+template<typename Leg, typename State>
+async<> race_leg(Leg leg, std::shared_ptr<State> st) {
+    fail_fast_slot<async_return_t<Leg>> v;
+    std::exception_ptr ex;
+    try {
+        if constexpr (std::is_void_v<async_return_t<Leg>>) {
+            co_await std::move(leg);
+            v.emplace();
+        } else {
+            v.emplace(co_await std::move(leg));
+        }
+    } catch (...) {
+        ex = std::current_exception();
+    }
+    if (ex) {
+        st->lose(ex);
+    } else if constexpr (std::is_void_v<async_return_t<Leg>>) {
+        st->win();
+    } else {
+        st->win(std::move(*v));
+    }
+}
+
+// The Future of a race of legs reporting to the same state.
+// The legs are moved into detached roots, the losers run to completion and their results are dropped.
+template<typename Ret, bool FirstSuccess>
+class race_future: protected future_base {
+private:
+    using State = race_state<Ret, FirstSuccess>;
+
+    std::vector<async<>> legs_;
+    std::shared_ptr<State> st_;
+
+private:
+    void set_sync_object(const sync_object& sync) {
+        st_->cb.promise = sync;
+        st_->cb.exception = &exception_;
+    }
+
+    void resume() {
+        for (auto& leg : legs_) {
+            if (auto* home = st_->home()) {
+                leg.start_root_in_this_thread(*home);
+            } else {
+                leg.start_root_in_this_thread();
+            }
+        }
+    }
+
+    Ret return_value() {
+        if constexpr (!std::is_void_v<Ret>) {
+            return std::move(*st_->value);
+        }
+    }
+
+    friend future_caller;
+
+public:
+    race_future(std::vector<async<>>&& legs, std::shared_ptr<State> st):
+        legs_(std::move(legs)), st_(std::move(st)) {}
+};
+
+// Fail the race after the deadline, nothing once it has been settled.
+// The timer can not be cancelled, it only wakes up to find the race over.
+template<typename State>
+async<> deadline_leg(sleep_function sleep, std::chrono::milliseconds d, std::shared_ptr<State> st) {
+    co_await sleep(d);
+    if (!st->resumed.load(std::memory_order_acquire)) {
+        st->lose(std::make_exception_ptr(timeout_error()));
+    }
+}
+
+// Start the attempt after the delay, unless the race has been settled.
+template<typename Factory, typename State>
+async<> start_after(Factory factory, sleep_function sleep, std::chrono::milliseconds d, std::shared_ptr<State> st) {
+    co_await sleep(d);
+    if (st->resumed.load(std::memory_order_acquire)) {
+        co_return;
+    }
+    co_await race_leg(factory(), std::move(st));
+}
+
+template<typename Factory>
+using factory_return_t = async_return_t<std::invoke_result_t<Factory&>>;
+
+// The attempt with its deadline.
+template<typename Ret>
+async<Ret> with_deadline(async<Ret> attempt, sleep_function sleep, std::chrono::milliseconds timeout) {
+    auto st = std::make_shared<race_state<Ret, false>>(2);
+    std::vector<async<>> legs;
+    legs.push_back(race_leg(std::move(attempt), st));
+    legs.push_back(deadline_leg(std::move(sleep), timeout, st));
+    co_return co_await race_future<Ret, false>(std::move(legs), std::move(st));
+}
+
+} // namespace detail
+
+// Call the factory again after a jittered exponential backoff while the attempt fails,
+// up to policy.max_attempts attempts and within the retry budget.
+// ```c++
+// auto v = co_await sco::retry([key] { return redis_get_async(key); }, policy);
+// ```
+template<typename Factory, typename Ret = detail::factory_return_t<Factory>>
+async<Ret> retry(Factory factory, retry_policy policy) {
+    static_assert(std::is_same_v<std::invoke_result_t<Factory&>, async<Ret>>, "the factory must return sco::async<Ret>");
+
+    if (policy.budget) {
+        policy.budget->deposit();
+    }
+
+    for (int attempt = 1;; ++attempt) {
+        std::exception_ptr ex;
+        try {
+            if (policy.attempt_timeout.count() > 0) {
+                co_return co_await detail::with_deadline(factory(), policy.sleep, policy.attempt_timeout);
+            }
+            co_return co_await factory();
+        } catch (...) {
+            ex = std::current_exception();
+        }
+
+        if (attempt >= policy.max_attempts || (policy.retryable && !policy.retryable(ex)) ||
+            (policy.budget && !policy.budget->withdraw())) {
+            std::rethrow_exception(ex);
+        }
+        if (policy.sleep) {
+            co_await policy.sleep(policy.backoff(attempt));
+        }
+    }
+}
+
+// Start a second attempt if the first has not finished after delay,
+// returns the first success, or the last failure if both fail.
+// The delay is usually a high percentile of the latency, e.g. from sco::latency_site::snapshot().
+// ```c++
+// auto v = co_await sco::hedge([key] { return redis_get_async(key); }, p95, sleep);
+// ```
+template<typename Factory, typename Ret = detail::factory_return_t<Factory>>
+async<Ret> hedge(Factory factory, std::chrono::milliseconds delay, sleep_function sleep) {
+    static_assert(std::is_same_v<std::invoke_result_t<Factory&>, async<Ret>>, "the factory must return sco::async<Ret>");
+
+    auto st = std::make_shared<detail::race_state<Ret, true>>(2);
+    std::vector<async<>> legs;
+    legs.push_back(detail::race_leg(factory(), st));
+    // the second attempt is not started if the first has finished.
+    legs.push_back(detail::start_after(std::move(factory), std::move(sleep), delay, st));
+    co_return co_await detail::race_future<Ret, true>(std::move(legs), std::move(st));
+}
+
+} // namespace sco
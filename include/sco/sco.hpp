@@ -1,5 +1,16 @@
 #pragma once
 
 #include <sco/async.hpp> // async
+#include <sco/executor.hpp> // loop_executor
+#include <sco/blocking.hpp> // blocking
+#include <sco/numa.hpp> // numa_pool
+#include <sco/sim.hpp> // sim_executor
 #include <sco/callback.hpp> // cb_tie
+#include <sco/context.hpp> // context
 #include <sco/all.hpp> // all
+#include <sco/retry.hpp> // retry
+#include <sco/stream.hpp> // stream
+#include <sco/parallel.hpp> // parallel_for
+#include <sco/metrics.hpp> // timed
+#include <sco/limiter.hpp> // adaptive_limiter
+#include <sco/pool.hpp> // pool
@@ -0,0 +1,68 @@
+#pragma once
+
+#ifndef SCO_HEADER_ONLY
+# include <sco/sim.hpp>
+#endif
+
+namespace sco {
+
+SCO_INLINE void sim_executor::post(detail::task* t) {
+    ready_.push_back(t);
+}
+
+SCO_INLINE void sim_executor::post_after(duration d, detail::task* t) {
+    if (d <= duration::zero()) {
+        post(t);
+        return;
+    }
+    timers_.push(timer{now_ + d, seq_++, t});
+}
+
+SCO_INLINE std::size_t sim_executor::run() {
+    return run_until(nullptr);
+}
+
+SCO_INLINE std::size_t sim_executor::run_for(duration d) {
+    auto deadline = now_ + d;
+    auto n = run_until(&deadline);
+    now_ = deadline;
+    return n;
+}
+
+SCO_INLINE std::size_t sim_executor::run_until(const duration* deadline) {
+    current_scope scope(this);
+
+    std::size_t n = 0;
+    std::exception_ptr ex;
+    for (;;) {
+        if (ready_.empty()) {
+            if (timers_.empty() || (deadline && timers_.top().when > *deadline)) {
+                break;
+            }
+            // jump to the earliest timer, the timers due at the same time run in the order they were set.
+            now_ = timers_.top().when;
+            while (!timers_.empty() && timers_.top().when == now_) {
+                ready_.push_back(timers_.top().t);
+                timers_.pop();
+            }
+        }
+
+        auto* t = ready_.front();
+        ready_.pop_front();
+        try {
+            t->run_(t);
+        } catch (...) {
+            if (!ex) {
+                ex = std::current_exception();
+            }
+        }
+        ++n;
+    }
+
+    if (ex) {
+        std::rethrow_exception(ex);
+    }
+    return n;
+}
+
+} // namespace sco
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <sco/callback.hpp>
+#include <sco/executor.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <queue>
+#include <vector>
+
+namespace sco {
+
+// A single-threaded executor with a virtual clock, for reproducible tests of timing-dependent code.
+// The tasks run in FIFO order, then the clock jumps to the earliest timer,
+// so a trace of hours of virtual time runs as fast as its tasks.
+// Everything, including post, must be called from the thread running it.
+// ```c++
+// sco::sim_executor sim;
+// void backend_async(int key, const std::function<void(int)>& cb) {
+//     sim.after(5ms, [cb, key] { cb(key); });
+// }
+// handle(1).start_root_in_this_thread(sim);
+// sim.run();
+// ```
+class sim_executor: public executor {
+public:
+    using duration = std::chrono::nanoseconds;
+
+private:
+    struct timer {
+        duration when;
+        // the order of the timers set for the same time.
+        std::uint64_t seq;
+        detail::task* t;
+
+        bool operator>(const timer& other) const noexcept {
+            return when != other.when ? when > other.when : seq > other.seq;
+        }
+    };
+
+    duration now_{};
+    std::uint64_t seq_{};
+    std::deque<detail::task*> ready_;
+    std::priority_queue<timer, std::vector<timer>, std::greater<>> timers_;
+
+public:
+    void post(detail::task* t) override;
+
+    // The virtual time since the start of the simulation.
+    duration now() const noexcept { return now_; }
+
+    // Run the task when the virtual clock reaches now() + d.
+    void post_after(duration d, detail::task* t);
+
+    // Call f when the virtual clock reaches now() + d, e.g. to complete a fake callback.
+    template<typename F>
+    void after(duration d, F&& f) {
+        post_after(d, new detail::function_task<std::decay_t<F>>(std::decay_t<F>(std::forward<F>(f))));
+    }
+
+    // Wait for d of virtual time.
+    auto sleep(duration d) {
+        class future: protected detail::future_base,
+            protected detail::future_with_value<void> {
+        private:
+            struct wake: public detail::task {
+                detail::callback_base cb;
+            };
+
+            sim_executor* sim_;
+            duration d_;
+            wake w_;
+
+        private:
+            void set_sync_object(const detail::sync_object& sync) {
+                w_.cb.promise = sync;
+                w_.cb.exception = &exception_;
+            }
+
+            void resume() {
+                w_.run_ = [](detail::task* t) {
+                    static_cast<wake*>(t)->cb.resume();
+                };
+                sim_->post_after(d_, &w_);
+            }
+
+            friend detail::future_caller;
+
+        public:
+            future(sim_executor* sim, duration d): sim_(sim), d_(d) {}
+        };
+
+        return future(this, d);
+    }
+
+    // Run the tasks and the timers until there are none left, returns the number of tasks run.
+    // The first exception thrown by a task is rethrown after the others have run.
+    std::size_t run();
+
+    // Run the tasks and the timers due until now() + d, then set the clock to now() + d.
+    std::size_t run_for(duration d);
+
+    // The tasks and timers left.
+    std::size_t pending() const noexcept { return ready_.size() + timers_.size(); }
+
+private:
+    std::size_t run_until(const duration* deadline);
+};
+
+} // namespace sco
+
+#ifdef SCO_HEADER_ONLY
+# include <sco/sim-inl.hpp>
+#endif
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <sco/callback.hpp>
+
+#include <cassert>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace sco {
+
+// What a push into a full stream buffer does.
+enum class stream_overflow {
+    // close the stream with stream_overflow_error, thrown after the buffered items.
+    fail,
+    // drop the item and count it.
+    drop,
+};
+
+// The outcome of a push.
+enum class stream_push {
+    // buffered or handed to the consumer.
+    ok,
+    // buffered, the buffer is full now, wait for the consumer before pushing again.
+    full,
+    // lost, the buffer was full and stream_overflow::drop dropped it.
+    dropped,
+    // lost, the stream is closed, also by stream_overflow::fail.
+    closed,
+};
+
+class stream_overflow_error: public std::runtime_error {
+public:
+    stream_overflow_error(): std::runtime_error("sco stream buffer overflow") {}
+};
+
+namespace detail {
+
+template<typename>
+struct stream_sign;
+
+template<typename... Args>
+struct stream_sign<void(Args...)> {
+    // make a callable with the exact callback signature.
+    template<typename Fn>
+    static auto make(Fn&& fn) {
+        return [fn = std::forward<Fn>(fn)](Args... args) mutable {
+            fn(std::forward<Args>(args)...);
+        };
+    }
+};
+
+// The state shared by the stream and its callbacks,
+// callbacks may be called from any thread.
+template<typename T>
+struct stream_state {
+    using ptr = std::shared_ptr<stream_state>;
+
+    // The Future of a pending next(), lives in the awaiting coroutine.
+    struct waiter {
+        callback_base cb;
+        std::optional<T>* value;
+    };
+
+    std::mutex mu;
+    std::deque<T> items;
+    std::size_t capacity;
+    stream_overflow overflow;
+    std::size_t dropped{};
+    bool closed{};
+    bool paused{};
+    std::exception_ptr error;
+    waiter* waiting{};
+
+    std::function<void()> on_pause, on_resume;
+
+    stream_state(std::size_t cap, stream_overflow of): capacity(cap ? cap : 1), overflow(of) {}
+
+    stream_push push(T&& v) {
+        std::unique_lock<std::mutex> lock(mu);
+        if (closed) {
+            return stream_push::closed;
+        }
+        if (waiting) {
+            // hand over directly, the buffer is empty.
+            auto* w = std::exchange(waiting, nullptr);
+            *w->value = std::move(v);
+            lock.unlock();
+            w->cb.resume();
+            return stream_push::ok;
+        }
+
+        if (items.size() >= capacity) {
+            if (overflow == stream_overflow::drop) {
+                ++dropped;
+                return stream_push::dropped;
+            }
+            close_locked(lock, std::make_exception_ptr(stream_overflow_error()));
+            return stream_push::closed;
+        }
+
+        items.push_back(std::move(v));
+        if (items.size() < capacity) {
+            return stream_push::ok;
+        }
+        if (!paused && on_pause) {
+            paused = true;
+            lock.unlock();
+            on_pause();
+        }
+        return stream_push::full;
+    }
+
+    void close(std::exception_ptr ex) {
+        std::unique_lock<std::mutex> lock(mu);
+        close_locked(lock, ex);
+    }
+
+    void close_locked(std::unique_lock<std::mutex>& lock, std::exception_ptr ex) {
+        if (closed) {
+            return;
+        }
+        closed = true;
+        error = ex;
+
+        if (auto* w = std::exchange(waiting, nullptr)) {
+            *w->cb.exception = error;
+            lock.unlock();
+            w->cb.resume();
+        }
+    }
+
+    // Returns false if the waiter is suspended until the next push or close.
+    bool pop(waiter& w) {
+        std::unique_lock<std::mutex> lock(mu);
+        assert(!waiting && "sco::stream has a single consumer");
+        if (items.empty()) {
+            if (!closed) {
+                waiting = &w;
+                return false;
+            }
+            *w.cb.exception = error;
+            return true;
+        }
+
+        *w.value = std::move(items.front());
+        items.pop_front();
+
+        // the consumer has drained half of the buffer.
+        if (paused && items.size() <= capacity / 2) {
+            paused = false;
+            lock.unlock();
+            if (on_resume) {
+                on_resume();
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace detail
+
+// A buffer of at most capacity items fed by callbacks that fire repeatedly,
+// consumed with `co_await s.next()` by a single coroutine, one next() at a time.
+// A push into a full buffer follows the overflow policy, the backpressure hooks
+// let a producer that can pause avoid it.
+// ```c++
+// sco::stream<std::string> s;
+// read_async(fd, s.on_data<void(const char*, size_t)>(), s.on_done<void()>(), s.on_error<void(int)>(make_error));
+// while (auto chunk = co_await s.next()) { ... }
+// ```
+template<typename T>
+class stream {
+private:
+    typename detail::stream_state<T>::ptr state_;
+
+public:
+    explicit stream(std::size_t capacity = 64, stream_overflow overflow = stream_overflow::fail):
+        state_(std::make_shared<detail::stream_state<T>>(capacity, overflow)) {}
+
+    // The backpressure hooks, pause is called when the buffer becomes full,
+    // resume when the consumer has drained it to half.
+    void set_backpressure(std::function<void()> pause, std::function<void()> resume) {
+        std::lock_guard<std::mutex> lock(state_->mu);
+        state_->on_pause = std::move(pause);
+        state_->on_resume = std::move(resume);
+    }
+
+    // Push an item directly.
+    stream_push push(T v) { return state_->push(std::move(v)); }
+
+    // The items dropped by stream_overflow::drop.
+    std::size_t dropped() const {
+        std::lock_guard<std::mutex> lock(state_->mu);
+        return state_->dropped;
+    }
+
+    // End the stream, items already buffered are still delivered.
+    void close(std::exception_ptr ex = {}) { state_->close(ex); }
+
+    // The data callback, constructs T from the callback arguments.
+    template<typename Sign>
+    auto on_data() {
+        return detail::stream_sign<Sign>::make([st = state_](auto&&... args) {
+            st->push(T(std::forward<decltype(args)>(args)...));
+        });
+    }
+
+    // The data callback, T is returned by fn.
+    template<typename Sign, typename Fn>
+    auto on_data(Fn&& fn) {
+        return detail::stream_sign<Sign>::make([st = state_, fn = std::forward<Fn>(fn)](auto&&... args) mutable {
+            st->push(fn(std::forward<decltype(args)>(args)...));
+        });
+    }
+
+    // The completion callback, the arguments are ignored.
+    template<typename Sign = void()>
+    auto on_done() {
+        return detail::stream_sign<Sign>::make([st = state_](auto&&...) {
+            st->close({});
+        });
+    }
+
+    // The error callback, the arguments are converted to an exception by fn.
+    template<typename Sign, typename Fn>
+    auto on_error(Fn&& fn) {
+        return detail::stream_sign<Sign>::make([st = state_, fn = std::forward<Fn>(fn)](auto&&... args) mutable {
+            using E = decltype(fn(std::forward<decltype(args)>(args)...));
+            if constexpr (std::is_same_v<std::decay_t<E>, std::exception_ptr>) {
+                st->close(fn(std::forward<decltype(args)>(args)...));
+            } else {
+                st->close(std::make_exception_ptr(fn(std::forward<decltype(args)>(args)...)));
+            }
+        });
+    }
+
+    // The error callback that receives the std::exception_ptr directly.
+    template<typename Sign = void(std::exception_ptr)>
+    auto on_error() {
+        return on_error<Sign>([](std::exception_ptr ex) { return ex; });
+    }
+
+    // Wait for the next item, std::nullopt means the stream is done.
+    // Single consumer, a second next() pending at the same time is a bug.
+    // The exception passed to an error callback is thrown after the buffered items.
+    auto next() {
+        using state_ptr = typename detail::stream_state<T>::ptr;
+
+        class future: protected detail::future_base {
+        private:
+            state_ptr st_;
+            typename detail::stream_state<T>::waiter w_;
+            std::optional<T> value_;
+
+        private:
+            void set_sync_object(const detail::sync_object& sync) {
+                w_.cb.promise = sync;
+                w_.cb.exception = &exception_;
+                w_.value = &value_;
+            }
+
+            void resume() {
+                if (st_->pop(w_)) {
+                    w_.cb.resume();
+                }
+            }
+
+            std::optional<T> return_value() { return std::move(value_); }
+
+            friend detail::future_caller;
+
+        public:
+            explicit future(state_ptr st): st_(std::move(st)) {}
+        };
+
+        return future(state_);
+    }
+};
+
+} // namespace sco
@@ -0,0 +1,341 @@
+#pragma once
+
+// The optional libuv awaitables, include it explicitly and link libuv.
+// The uv request or handle lives in the Future, which lives in the awaiting coroutine frame,
+// so an operation allocates nothing.
+// Like libuv itself, the operations must be started in the thread running the loop.
+
+#include <sco/callback.hpp>
+
+#include <uv.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace sco::uv {
+
+// Thrown for a negative libuv status.
+class error: public std::runtime_error {
+private:
+    int code_;
+
+public:
+    explicit error(int code): std::runtime_error(uv_strerror(code)), code_(code) {}
+
+    int code() const noexcept { return code_; }
+};
+
+} // namespace sco::uv
+
+namespace sco::detail {
+
+// The state shared by the uv futures, the callbacks find it through the data field of the uv request.
+struct uv_future_base: protected future_base {
+    callback_base cb_;
+
+    void set_sync_object(const sync_object& sync) {
+        cb_.promise = sync;
+        cb_.exception = &exception_;
+    }
+
+    // Complete with the libuv status, the Future may be destroyed on return.
+    void done(int status) {
+        if (status < 0) {
+            exception_ = std::make_exception_ptr(uv::error(status));
+        }
+        cb_.resume();
+    }
+};
+
+template<typename Ret, typename Fn, typename... Args>
+class uv_fs_future: protected uv_future_base,
+    protected future_with_value<Ret> {
+private:
+    uv_loop_t* loop_;
+    uv_fs_t req_;
+    Fn fn_;
+    std::tuple<Args...> args_;
+
+private:
+    void resume() {
+        req_.data = this;
+        int r = std::apply([this](Args&... args) {
+            return fn_(loop_, &req_, args..., &uv_fs_future::on_done);
+        }, args_);
+        if (r < 0) {
+            uv_fs_req_cleanup(&req_);
+            done(r);
+        }
+    }
+
+    static void on_done(uv_fs_t* req) {
+        auto* self = static_cast<uv_fs_future*>(req->data);
+        auto status = static_cast<int>(req->result < 0 ? req->result : 0);
+        if (status == 0) {
+            if constexpr (std::is_same_v<Ret, uv_stat_t>) {
+                self->value_ = req->statbuf;
+            } else {
+                self->value_ = req->result;
+            }
+        }
+        uv_fs_req_cleanup(req);
+        self->done(status);
+    }
+
+    friend future_caller;
+
+public:
+    uv_fs_future(uv_loop_t* loop, Fn fn, Args... args):
+        loop_(loop), fn_(fn), args_(std::move(args)...) {}
+};
+
+} // namespace sco::detail
+
+namespace sco::uv {
+
+// Wait for timeout milliseconds on a uv timer owned by the Future.
+inline auto sleep(uv_loop_t* loop, std::uint64_t timeout) {
+    class future: protected detail::uv_future_base,
+        protected detail::future_with_value<void> {
+    private:
+        uv_loop_t* loop_;
+        std::uint64_t timeout_;
+        uv_timer_t timer_;
+
+    private:
+        void resume() {
+            uv_timer_init(loop_, &timer_);
+            timer_.data = this;
+            int r = uv_timer_start(&timer_, &future::on_timer, timeout_, 0);
+            if (r < 0) {
+                status_ = r;
+                close();
+            }
+        }
+
+        // the handle must be closed before the frame holding it is freed.
+        void close() {
+            uv_close(reinterpret_cast<uv_handle_t*>(&timer_), [](uv_handle_t* h) {
+                auto* self = static_cast<future*>(h->data);
+                self->done(self->status_);
+            });
+        }
+
+        static void on_timer(uv_timer_t* t) {
+            static_cast<future*>(t->data)->close();
+        }
+
+        int status_{};
+
+        friend detail::future_caller;
+
+    public:
+        future(uv_loop_t* loop, std::uint64_t timeout): loop_(loop), timeout_(timeout) {}
+    };
+
+    return future(loop, timeout);
+}
+
+// Connect an initialized tcp handle.
+inline auto connect(uv_tcp_t* tcp, const sockaddr* addr) {
+    class future: protected detail::uv_future_base,
+        protected detail::future_with_value<void> {
+    private:
+        uv_tcp_t* tcp_;
+        const sockaddr* addr_;
+        uv_connect_t req_;
+
+    private:
+        void resume() {
+            req_.data = this;
+            int r = uv_tcp_connect(&req_, tcp_, addr_, [](uv_connect_t* req, int status) {
+                static_cast<future*>(req->data)->done(status);
+            });
+            if (r < 0) {
+                done(r);
+            }
+        }
+
+        friend detail::future_caller;
+
+    public:
+        future(uv_tcp_t* tcp, const sockaddr* addr): tcp_(tcp), addr_(addr) {}
+    };
+
+    return future(tcp, addr);
+}
+
+// Write the buffers, which must stay valid until the write completes.
+inline auto write(uv_stream_t* stream, const uv_buf_t* bufs, unsigned int nbufs) {
+    class future: protected detail::uv_future_base,
+        protected detail::future_with_value<void> {
+    private:
+        uv_stream_t* stream_;
+        const uv_buf_t* bufs_;
+        unsigned int nbufs_;
+        uv_write_t req_;
+
+    private:
+        void resume() {
+            req_.data = this;
+            int r = uv_write(&req_, stream_, bufs_, nbufs_, [](uv_write_t* req, int status) {
+                static_cast<future*>(req->data)->done(status);
+            });
+            if (r < 0) {
+                done(r);
+            }
+        }
+
+        friend detail::future_caller;
+
+    public:
+        future(uv_stream_t* stream, const uv_buf_t* bufs, unsigned int nbufs):
+            stream_(stream), bufs_(bufs), nbufs_(nbufs) {}
+    };
+
+    return future(stream, bufs, nbufs);
+}
+
+// Write a single buffer, the data must stay valid until the write completes.
+inline auto write(uv_stream_t* stream, std::string_view data) {
+    class future: protected detail::uv_future_base,
+        protected detail::future_with_value<void> {
+    private:
+        uv_stream_t* stream_;
+        uv_buf_t buf_;
+        uv_write_t req_;
+
+    private:
+        void resume() {
+            req_.data = this;
+            int r = uv_write(&req_, stream_, &buf_, 1, [](uv_write_t* req, int status) {
+                static_cast<future*>(req->data)->done(status);
+            });
+            if (r < 0) {
+                done(r);
+            }
+        }
+
+        friend detail::future_caller;
+
+    public:
+        future(uv_stream_t* stream, std::string_view data): stream_(stream),
+            buf_(uv_buf_init(const_cast<char*>(data.data()), static_cast<unsigned int>(data.size()))) {}
+    };
+
+    return future(stream, data);
+}
+
+// Read at most len bytes into buf, returns 0 at the end of the stream.
+// The data field of the stream is used while the read is pending.
+inline auto read(uv_stream_t* stream, char* buf, std::size_t len) {
+    class future: protected detail::uv_future_base,
+        protected detail::future_with_value<std::size_t> {
+    private:
+        uv_stream_t* stream_;
+        char* buf_;
+        std::size_t len_;
+
+    private:
+        void resume() {
+            stream_->data = this;
+            int r = uv_read_start(stream_, [](uv_handle_t* h, std::size_t, uv_buf_t* buf) {
+                auto* self = static_cast<future*>(h->data);
+                *buf = uv_buf_init(self->buf_, static_cast<unsigned int>(self->len_));
+            }, [](uv_stream_t* s, ssize_t nread, const uv_buf_t*) {
+                if (nread == 0) {
+                    return; // EAGAIN
+                }
+                uv_read_stop(s);
+
+                auto* self = static_cast<future*>(s->data);
+                if (nread == UV_EOF) {
+                    self->value_ = 0;
+                } else if (nread > 0) {
+                    self->value_ = static_cast<std::size_t>(nread);
+                }
+                self->done(nread < 0 && nread != UV_EOF ? static_cast<int>(nread) : 0);
+            });
+            if (r < 0) {
+                done(r);
+            }
+        }
+
+        friend detail::future_caller;
+
+    public:
+        future(uv_stream_t* stream, char* buf, std::size_t len): stream_(stream), buf_(buf), len_(len) {}
+    };
+
+    return future(stream, buf, len);
+}
+
+// Call a uv_fs_* function, the loop, the request and the callback are supplied,
+// returns the result of the request, e.g. the file descriptor or the bytes read.
+// ```c++
+// auto fd = co_await sco::uv::fs(loop, uv_fs_open, path, O_RDONLY, 0);
+// auto n = co_await sco::uv::fs(loop, uv_fs_read, uv_file(fd), &buf, 1u, int64_t(-1));
+// ```
+template<typename Fn, typename... Args>
+auto fs(uv_loop_t* loop, Fn fn, Args... args) {
+    return detail::uv_fs_future<ssize_t, Fn, Args...>(loop, fn, std::move(args)...);
+}
+
+// Stat a path, returns the uv_stat_t.
+inline auto fs_stat(uv_loop_t* loop, const char* path) {
+    return detail::uv_fs_future<uv_stat_t, decltype(&uv_fs_stat), const char*>(loop, &uv_fs_stat, path);
+}
+
+// Run fn in the libuv thread pool, the coroutine is resumed by the loop with its result.
+template<typename F>
+auto work(uv_loop_t* loop, F fn) {
+    using Ret = std::invoke_result_t<F&>;
+
+    class future: protected detail::uv_future_base,
+        protected detail::future_with_value<Ret> {
+    private:
+        uv_loop_t* loop_;
+        F fn_;
+        std::exception_ptr error_;
+        uv_work_t req_;
+
+    private:
+        void resume() {
+            req_.data = this;
+            int r = uv_queue_work(loop_, &req_, [](uv_work_t* req) {
+                auto* self = static_cast<future*>(req->data);
+                try {
+                    if constexpr (std::is_void_v<Ret>) {
+                        self->fn_();
+                    } else {
+                        self->value_ = self->fn_();
+                    }
+                } catch (...) {
+                    self->error_ = std::current_exception();
+                }
+            }, [](uv_work_t* req, int status) {
+                auto* self = static_cast<future*>(req->data);
+                if (self->error_) {
+                    self->exception_ = std::move(self->error_);
+                }
+                self->done(status);
+            });
+            if (r < 0) {
+                done(r);
+            }
+        }
+
+        friend detail::future_caller;
+
+    public:
+        future(uv_loop_t* loop, F fn): loop_(loop), fn_(std::move(fn)) {}
+    };
+
+    return future(loop, std::move(fn));
+}
+
+} // namespace sco::uv
@@ -2,7 +2,14 @@
 #    error Please define SCO_COMPILED_LIB to compile this file.
 #endif
 
+#include <sco/executor-inl.hpp>
+#include <sco/numa-inl.hpp>
 #include <sco/promise-inl.hpp>
 #include <sco/future-inl.hpp>
 #include <sco/callback-inl.hpp>
 #include <sco/async-inl.hpp>
+#include <sco/metrics-inl.hpp>
+#include <sco/limiter-inl.hpp>
+#include <sco/blocking-inl.hpp>
+#include <sco/context-inl.hpp>
+#include <sco/sim-inl.hpp>